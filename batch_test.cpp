@@ -0,0 +1,83 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+//  xml_batch_parser over the corpus, repeated and mixed with documents that fail, against xml_document::parse of each
+//  on its own.  Ordered and unordered, every document has to be handed to on_document once with its index and the
+//  tree parse() builds, the results have to be the lengths parse() returns, in input order, and ordered the calls
+//  have to come in input order.
+//
+//  usage:  batch_test, exits non zero when a check fails
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "jacob_parser.h"
+#include "xml_batch.h"
+#include "xml_test.h"
+#include "xml_thread_pool.h"
+
+namespace {
+    using document = xml_document<char>;
+
+    constexpr auto npos = static_cast<std::size_t>(-1);
+
+    std::vector<std::string> documents() {
+        const auto corpus = xml_test_corpus();
+        std::vector<std::string> out;
+        for (int i = 0; i < 20; ++i) {
+            out.insert(out.end(), corpus.begin(), corpus.end());
+            out.emplace_back("<a><b></a></b>");
+            out.emplace_back("<a>");
+        }
+        return out;
+    }
+
+    void batches(xml_test &t, xml_thread_pool &pool, const bool ordered, const std::size_t batch_size) {
+        const auto src = documents();
+        std::vector<std::unique_ptr<document>> refs;
+        std::vector<std::size_t> lengths;
+        for (const auto &s : src) {
+            refs.push_back(std::make_unique<document>());
+            lengths.push_back(refs.back()->parse(s));
+        }
+
+        //  each index is written by the one call that hands its document over
+        std::vector<int> calls(src.size(), 0);
+        std::vector<std::string> diffs(src.size());
+        std::vector<std::size_t> order;     //  only written in ordered mode, where the calls come one at a time
+        xml_batch_parser<char> batch(pool, xml_batch_options{batch_size, ordered});
+        const auto results = batch.parse(src, [&](std::size_t i, const document &doc) {
+            ++calls[i];
+            if (lengths[i] != npos) diffs[i] = xml_tree_diff(refs[i]->root(), doc.root());
+            if (ordered) order.push_back(i);
+        });
+
+        const auto where = std::string(ordered ? "ordered" : "unordered") + " in batches of " +
+                           std::to_string(batch_size);
+        if (!t.check(results.size() == src.size(), where + " : " + std::to_string(results.size()) + " results")) return;
+        for (std::size_t i = 0; i < src.size(); ++i) {
+            const auto at = where + " : document " + std::to_string(i) + ' ';
+            t.check(calls[i] == 1, at + "handed over " + std::to_string(calls[i]) + " times");
+            t.check(static_cast<std::size_t>(results[i]) == lengths[i],
+                    at + "parsed " + std::to_string(static_cast<std::size_t>(results[i])));
+            t.check(static_cast<bool>(results[i]) == (lengths[i] == npos), at + "has the wrong error");
+            t.check(diffs[i].empty(), at + diffs[i]);
+        }
+        if (!ordered) return;
+        bool in_order = order.size() == src.size();
+        for (std::size_t i = 0; in_order && i < order.size(); ++i) in_order = order[i] == i;
+        t.check(in_order, where + " : the documents were not handed over in input order");
+    }
+}
+
+int main() {
+    xml_test t("batch_test");
+    xml_thread_pool pool(4);
+    for (const bool ordered : {false, true}) {
+        for (std::size_t batch_size : {std::size_t(1), std::size_t(3), std::size_t(16)}) {
+            batches(t, pool, ordered, batch_size);
+        }
+    }
+    return t.report();
+}
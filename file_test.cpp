@@ -0,0 +1,103 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+//  Parsing straight from a file mapping, in every parse_mode and through the sax parser and the reader, against
+//  parsing the file's text from a string.  The files end the way files do, in a newline or other white space, and one
+//  fills its last page exactly so the mapping has to supply the terminator after it.
+//
+//  usage:  file_test, exits non zero when a check fails
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include "jacob_parser.h"
+#include "xml_reader.h"
+#include "xml_sax.h"
+#include "xml_test.h"
+
+namespace {
+    using document = xml_document<char>;
+
+    ///  a file removed when it goes
+    class temp_file {
+    public:
+        explicit temp_file(const std::string &text) :
+                m_path(std::filesystem::temp_directory_path() /
+                       ("file_test_" + std::to_string(::getpid()) + "_" + std::to_string(s_count++) + ".xml")) {
+            std::ofstream(m_path, std::ios::binary) << text;
+        }
+
+        ~temp_file() { std::filesystem::remove(m_path); }
+
+        [[nodiscard]] std::string path() const { return m_path.string(); }
+
+    private:
+        static inline int s_count = 0;
+        std::filesystem::path m_path;
+    };
+
+    std::vector<std::string> files() {
+        std::vector<std::string> out{
+                "<?xml version=\"1.0\"?>\n<a b=\"1\">x</a>\n",
+                "<a/>\r\n",
+                "<a>t</a>\n\n\t \n",
+                "<a>t</a><!--after-->\n",
+                "<a>t</a>",
+        };
+        for (auto &src : xml_test_corpus()) out.push_back(src + '\n');
+
+        //  the newline is the last byte of the page
+        std::string page = "<a>";
+        page.append(4096 - page.length() - 5, 'p');
+        page += "</a>\n";
+        out.push_back(std::move(page));
+        return out;
+    }
+
+    void documents(xml_test &t) {
+        for (const auto &src : files()) {
+            const temp_file file(src);
+            const auto where = src.substr(0, 30);
+
+            document ref;
+            t.check(ref.parse(src) == src.length(), where + " : did not parse from a string");
+
+            for (const auto mode : {parse_mode::copy, parse_mode::view, parse_mode::in_situ}) {
+                document doc(mode);
+                const auto parsed = doc.parse_file(file.path());
+                if (!t.check(parsed == src.length(), where + " : parse_file in mode " +
+                                                     std::to_string(static_cast<int>(mode)) + " returned " +
+                                                     std::to_string(parsed))) {
+                    continue;
+                }
+                auto diff = xml_tree_diff(ref.prolog(), doc.prolog());
+                if (diff.empty()) diff = xml_tree_diff(ref.root(), doc.root());
+                t.check(diff.empty(), where + " : " + diff);
+            }
+
+            xml_test_events events;
+            xml_sax_parser<char, xml_test_events> sax(events);
+            t.check(sax.parse_file(file.path().c_str()) == src.length(), where + " : the sax parse_file failed");
+
+            auto reader = xml_reader<char>::open_file(file.path().c_str());
+            auto tok = reader.next();
+            while (tok != xml_token::end_document && tok != xml_token::error) tok = reader.next();
+            t.check(tok == xml_token::end_document, where + " : the reader did not read the file to its end");
+        }
+    }
+
+    void missing(xml_test &t) {
+        document doc;
+        t.check(doc.parse_file("/nonexistent/file.xml") == static_cast<std::size_t>(-1), "a missing file parsed");
+    }
+}
+
+int main() {
+    xml_test t("file_test");
+    documents(t);
+    missing(t);
+    return t.report();
+}
@@ -0,0 +1,83 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+//  Text of xml_flat_document against the text xml_document decodes.  Runs that are all references, or that mix
+//  references with plain text, are built from pieces the sax parser hands over from temporaries of its own, which
+//  the document has to copy before the call returns.
+//
+//  usage:  flat_test, exits non zero when a document does not match
+
+#include <iostream>
+#include <string>
+#include "jacob_parser.h"
+#include "xml_flat.h"
+
+namespace {
+    struct text_case {
+        const char *xml;
+        const char *value;      //  of the root element
+    };
+
+    constexpr text_case cases[] = {
+            {"<a>&amp;</a>",                   "&"},
+            {"<a>&#65;</a>",                   "A"},
+            {"<a>&#x42;</a>",                  "B"},
+            {"<a>&gt;&lt;</a>",                "><"},
+            {"<a>&apos;&quot;&amp;</a>",       "'\"&"},
+            {"<a>x&amp;y</a>",                 "x&y"},
+            {"<a>&lt;x</a>",                   "<x"},
+            {"<a>plain</a>",                   "plain"},
+            {"<a>&amp;<b/>&lt;</a>",           "&"},
+            {"<a><b>&#65;&#66;</b></a>",       ""},
+    };
+
+    bool check(const text_case &c) {
+        const std::string src(c.xml);
+        xml_flat_document<> flat;
+        if (flat.parse(src) != src.length()) {
+            std::cerr << c.xml << " : the flat document did not parse\n";
+            return false;
+        }
+
+        xml_document<char> doc;
+        if (doc.parse(src) != src.length()) {
+            std::cerr << c.xml << " : the document did not parse\n";
+            return false;
+        }
+
+        //  every text node against the text of the tree, in document order
+        std::string flat_text, doc_text;
+        std::vector<xml_flat_document<>::node> flat_open{flat.root()};
+        while (!flat_open.empty()) {
+            const auto n = flat_open.back();
+            flat_open.pop_back();
+            if (n.type() == node_type::data) flat_text.append(n.value()).push_back('|');
+            std::vector<xml_flat_document<>::node> children(n.children().begin(), n.children().end());
+            flat_open.insert(flat_open.end(), children.rbegin(), children.rend());
+        }
+        std::vector<const xml_node<char> *> doc_open{&doc.root().children().front()};
+        while (!doc_open.empty()) {
+            const auto *n = doc_open.back();
+            doc_open.pop_back();
+            if (n->type() == node_type::data) doc_text.append(n->value()).push_back('|');
+            for (auto it = n->children().rbegin(); it != n->children().rend(); ++it) doc_open.push_back(&*it);
+        }
+
+        const auto value = flat.root().value();
+        if (value != c.value || flat_text != doc_text) {
+            std::cerr << c.xml << " : value \"" << value << "\" expected \"" << c.value << "\", text \"" << flat_text
+                      << "\" expected \"" << doc_text << "\"\n";
+            return false;
+        }
+        return true;
+    }
+}
+
+int main() {
+    int failed = 0;
+    for (const auto &c : cases) failed += !check(c);
+    std::cout << (sizeof(cases) / sizeof(cases[0]) - failed) << " of " << sizeof(cases) / sizeof(cases[0])
+              << " documents match" << std::endl;
+    return failed != 0;
+}
@@ -5,51 +5,25 @@
 #ifndef PARSER_JACOB_PARSER_H
 #define PARSER_JACOB_PARSER_H
 
+#include <algorithm>
 #include <string>
+#include <limits>
 #include <list>
-#include <map>
 #include <memory_resource>
+#include <optional>
+#include <array>
+#include <iostream>
+#include <memory>
+#include <vector>
 #include "xml_constants.h"
-
-class print_mem_resource : public std::pmr::memory_resource {
-public:
-    print_mem_resource(std::string name, std::pmr::memory_resource *upstream = std::pmr::new_delete_resource()) :
-            m_name(std::move(name)), m_upstream(upstream) {}
-
-private:
-    std::string m_name;
-    std::pmr::memory_resource *m_upstream;
-
-    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
-        auto result = m_upstream->allocate(bytes, alignment);
-        std::cout << "Allocating name : " << m_name
-                  << " size : " << bytes
-                  << " alignment : " << alignment
-                  << " address : " << result
-                  << std::endl;
-        return result;
-    };
-
-    void do_deallocate(void *p, size_t bytes, std::size_t alignment) override {
-        std::cout << "De-Allocating name : " << m_name
-                  << " size : " << bytes
-                  << " alignment : " << alignment
-                  << " address : " << p
-                  << std::endl;
-        m_upstream->deallocate(p, bytes, alignment);
-    }
-
-    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
-        return this == &other;
-    }
-};
-
+#include "xml_file.h"
+#include "xml_arena.h"
 
 // Forward declarations
 template<class Ch>
 class xml_node;
 
-template<class Ch, std::size_t Buff>
+template<class Ch, std::size_t Buff, class Trace>
 class xml_document;
 
 
@@ -107,6 +81,26 @@ std::ostream &operator<<(std::ostream &lhs, node_type rhs) {
     }
 }
 
+///  how xml_node names and values hold their text
+enum class parse_mode {
+    copy,       //  copied out of the source and decoded while parsing
+    view,       //  views into the source, references decoded on first access.  The source must outlive the nodes
+    in_situ     //  views into the source, references decoded over the source while parsing.  Destroys the source
+};
+
+std::ostream &operator<<(std::ostream &lhs, parse_mode rhs) {
+    switch (rhs) {
+        case parse_mode::copy:
+            return lhs << "Copy Parse Mode";
+        case parse_mode::view:
+            return lhs << "View Parse Mode";
+        case parse_mode::in_situ:
+            return lhs << "In Situ Parse Mode";
+        default:
+            return lhs;
+    }
+}
+
 /*
  * Element                  <></>              name value attributes children
  * Cdata section            <![CDATA[  ]]>>    value
@@ -128,7 +122,7 @@ node_type identify_node_type(const std::basic_string_view<CharT> i) {
             return node_type::element;
         case CharT('?'):
             //  parse_declaration() or
-            if (xml_const_compare<CharT, true>(std::basic_string_view<CharT>(&i[2]), "xml"))
+            if (xml_const_compare<CharT, true>(i.substr(2), "xml"))
                 return node_type::xmldecl;
 
             //  parse_pi()
@@ -157,11 +151,21 @@ node_type identify_node_type(const std::basic_string_view<CharT> i) {
     return node_type::unknown;
 }
 
+#include "xml_trace.h"
+#include "xml_stats.h"
+#include "xml_profile.h"
 #include "xml_traits.h"
+#include "xml_string.h"
+#include "xml_atoms.h"
+#include "xml_attributes.h"
 
 template<typename CharT=char>
 class xml_node {
-    friend class xml_traits<CharT>;
+    template<class Ch, class Trace>
+    friend class xml_traits;
+
+    template<class Ch, std::size_t Buff, class Trace>
+    friend class xml_document;
 
     using grammar = xml_traits<CharT>;
     using string_type = std::pmr::basic_string<CharT>;
@@ -173,8 +177,8 @@ protected:
     using node_container = std::pmr::list<xml_node<CharT>>;
 //    using attr_container = std::pmr::list<xml_attribute<CharT>>;
 
-    ///  utilizing std::map because the order does not matter and all attributes should be unique
-    using attr_container = std::pmr::map<string_type, string_type>;
+    ///  a flat array in source order, found by name through a hashed index once there are more than a few
+    using attr_container = xml_attributes<CharT>;
 
 public:
     template<class C>
@@ -184,66 +188,118 @@ public:
     explicit xml_node(node_type n) : m_type(n), m_attr(),
                                      m_children(), m_name(), m_value() {}
 
-    xml_node(node_type n, const allocator_type &alloc) : m_alloc(alloc), m_type(n), m_attr(alloc),
-                                                         m_children(alloc), m_name(alloc), m_value(alloc) {}
+    xml_node(node_type n, const allocator_type &alloc, parse_mode mode = parse_mode::copy) :
+            m_alloc(alloc), m_type(n), m_attr(alloc), m_children(alloc), m_name(alloc), m_value(alloc), m_mode(mode) {}
+
+    xml_node(xml_node &&) = default;
+
+    ~xml_node() { destroy_children(); }
 
 
-    node_type type() { return m_type; }
+    [[nodiscard]] node_type type() const { return m_type; }
 
+    ///  drops everything the node holds and gives the memory back, so the arena under it can be rewound
     void clear() {
-        m_attr.clear();
-        m_children.clear();
+        m_attr.release();
+        destroy_children();
+        m_name.release();
+        m_value.release();
+        m_atom = xml_atom::none;
+        m_deferred = false;
     };
 
+    ///  Parse what a lazy parse deferred, see xml_document::parse_lazy.  children(), attributes() and value() call it
+    ///  themselves, call it first to find out whether the element parses: false when it does not, and the node is left
+    ///  with only its name.  Elements in it may nest as deep as the document's max_depth left them.  Nothing to do for
+    ///  a node that is not deferred.
+    ///
+    ///  It parses with no trace, xml_document::expand parses with the document's
+    bool expand() { return expand<grammar>(); }
+
+    ///  the element's content has not been parsed yet
+    [[nodiscard]] bool deferred() const { return m_deferred; }
+
     template<class... Args>
     inline xml_node<CharT> &emplace_back_child(Args &&... args) {
-        std::cout << "emplacing node into node" << std::endl;
         return m_children.emplace_back(std::forward<Args>(args)...);
     }
 
     template<class... Args>
     inline auto child_push_back(Args &&... args) {
-        std::cout << "pushing node into node" << std::endl;
         return m_children.push_back(std::forward<Args>(args)...);
     }
 
-    template<class... Args>
-    inline auto insert_attribute(Args &&... args) {
-        std::cout << "inserting attribute" << std::endl;
-        return m_attr.insert(std::forward<Args>(args)...);
+    ///  raw is the attribute value as it appears in the source, coded when it holds references.
+    ///  false when the node already has an attribute called name
+    inline bool insert_attribute(const view_type name, const view_type raw, const bool coded) {
+        if (m_attr.contains(name)) return false;
+        xml_string<CharT> n{m_alloc};
+        xml_string<CharT> v{m_alloc};
+        const auto atom = assign_atom(&n, name);
+        assign(&v, raw, coded);
+        m_attr.emplace(std::move(n), std::move(v), atom);
+        return true;
     }
 
 
     template<class... Args>
     inline auto emplace_attribute(Args &&... args) {
-        std::cout << "emplacing attribute" << std::endl;
         return m_attr.emplace(std::make_pair(std::forward<Args>(args)...));
     }
 
-    template<class... Args>
-    inline auto assign_name(Args &&... args){
-        return m_name.assign(std::forward<Args>(args)...);
+    inline void assign_name(const view_type name) {
+        m_atom = assign_atom(&m_name, name);
     }
 
-    template<class... Args>
-    inline auto assign_value(Args &&... args){
-        return m_value.assign(std::forward<Args>(args)...);
+    ///  raw is the value as it appears in the source, coded when it holds references
+    inline void assign_value(const view_type raw, const bool coded) {
+        assign(&m_value, raw, coded);
     }
 
     const allocator_type &get_alloc() {
         return m_alloc;
     }
 
-    [[nodiscard]] const string_type &name() const { return m_name; }
+    [[nodiscard]] parse_mode mode() const { return m_mode; }
+
+    [[nodiscard]] view_type name() const { return m_name.view(); }
+
+    ///  the interned name, none when the node was parsed without an atom table
+    [[nodiscard]] xml_atom atom() const { return m_atom; }
+
+    [[nodiscard]] view_type value() const {
+        expand_deferred();
+        return m_value.view();
+    }
+
+    const node_container &children() const {
+        expand_deferred();
+        return m_children;
+    }
 
-    [[nodiscard]] const string_type &value() const { return m_value; }
+    const attr_container &attributes() const {
+        expand_deferred();
+        return m_attr;
+    }
 
-    const node_container &children() const { return m_children; }
+    ///  the first child called atom, or nullptr
+    const xml_node<CharT> *find_child(const xml_atom atom) const {
+        expand_deferred();
+        for (auto &c : m_children) if (c.m_atom == atom && atom != xml_atom::none) return &c;
+        return nullptr;
+    }
 
-    const attr_container &attributes() const { return m_children; }
+    ///  the value of the attribute called atom, or nullptr
+    const xml_string<CharT> *find_attribute(const xml_atom atom) const {
+        expand_deferred();
+        auto it = m_attr.find(atom);
+        return it == m_attr.end() ? nullptr : &it->second;
+    }
 
     xml_node<CharT> create_node(node_type n) {
-        return {n, get_alloc()};
+        xml_node<CharT> out{n, get_alloc(), m_mode};
+        out.m_atoms = m_atoms;
+        return out;
     }
 
 protected:
@@ -252,94 +308,355 @@ protected:
 
     attr_container m_attr;
     node_container m_children;
-    string_type m_name;
-    string_type m_value;
+    xml_string<CharT> m_name;
+    xml_string<CharT> m_value;
+    parse_mode m_mode;
+    std::uint32_t m_deferred_depth = 0;         //  the depth a deferred element may nest to, in the padding after m_mode
+    xml_atom_table<CharT> *m_atoms = nullptr;   //  names are interned here when there is one
+    xml_atom m_atom = xml_atom::none;
     bool m_attr_quot = true; //  attributes use either ' or "
-};
-
-template<std::size_t Buff>
-class xml_mem_resource : public std::pmr::memory_resource {
-public:
-    xml_mem_resource() : m_buffer(),
-                         t_alloc(m_buffer.data(), m_buffer.size()),
-                         m_memresource("Monotronic", &t_alloc) {}  // misspelling is on purpose I think its funny
+    bool m_deferred = false; //  a lazy parse left the element for expand, m_value views its source till then
 
 private:
-    std::array<std::byte, Buff> m_buffer;
-    std::pmr::monotonic_buffer_resource t_alloc;
-    print_mem_resource m_memresource;
+    ///  Nodes are never made const, only handed out as const, so the first read of a deferred node may still parse it
+    void expand_deferred() const {
+        if (m_deferred) const_cast<xml_node *>(this)->expand();
+    }
 
-    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
-        return m_memresource.allocate(bytes, alignment);
+    void defer(const view_type source, const std::size_t max_depth) {
+        m_value.assign_view(source, false);
+        m_deferred = true;
+        m_deferred_depth = static_cast<std::uint32_t>(std::min<std::size_t>(max_depth, std::numeric_limits<std::uint32_t>::max()));
     }
 
-    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
-        m_memresource.deallocate(p, bytes, alignment);
+    template<typename Grammar>
+    bool expand() {
+        if (!m_deferred) return true;
+        const auto source = m_value.view();
+        m_value.clear();
+        m_deferred = false;
+        //  the element has to end where the lazy parse found its end
+        const auto out = Grammar::Element(this, source, m_deferred_depth);
+        if (!out && static_cast<std::size_t>(out) == source.length()) return true;
+        m_attr.release();
+        destroy_children();
+        m_value.release();
+        return false;
     }
 
-    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
-        return this == &other;
+    ///  Destroy the children leaves first, so tearing down a tree of any depth takes no more native stack than a leaf.
+    ///  The lists still to be emptied are kept in a buffer on the stack, past 64 deep in memory from the heap
+    void destroy_children() noexcept {
+        if (m_children.empty()) return;
+        std::array<std::byte, 64 * sizeof(node_container *)> local;
+        std::pmr::monotonic_buffer_resource memory(local.data(), local.size());
+        std::pmr::vector<node_container *> lists(&memory);
+        lists.reserve(64);
+        lists.push_back(&m_children);
+        while (!lists.empty()) {
+            auto list = lists.back();
+            if (list->empty()) {
+                lists.pop_back();
+            } else if (!list->back().m_children.empty()) {
+                lists.push_back(&list->back().m_children);
+            } else {
+                list->pop_back();
+            }
+        }
+    }
+
+    ///  an interned name is a view of the table's copy, whatever the mode
+    xml_atom assign_atom(xml_string<CharT> *st, const view_type name) {
+        if (!m_atoms) {
+            assign(st, name, false);
+            return xml_atom::none;
+        }
+        view_type kept;
+        const auto atom = m_atoms->intern(name, &kept);
+        st->assign_view(kept, false);
+        return atom;
+    }
+
+    void assign(xml_string<CharT> *st, const view_type raw, const bool coded) {
+        switch (m_mode) {
+            case parse_mode::view:
+                st->assign_view(raw, coded);
+                break;
+            case parse_mode::in_situ:
+                if (coded) st->decode_in_place(raw); else st->assign_view(raw, false);
+                break;
+            case parse_mode::copy:
+            default:
+                if (coded) st->assign_decoded(raw); else st->assign(raw);
+                break;
+        }
     }
 };
 
-template<typename CharT=char, std::size_t Buff = 4096>
+///  A document's own arena, which starts in Buff bytes held inline and chains blocks from the heap past that
+template<std::size_t Buff>
+class xml_mem_resource : public xml_arena_resource {
+public:
+    explicit xml_mem_resource(const xml_arena_options &options = {}) :
+            xml_arena_resource(m_buffer.data(), m_buffer.size(), options) {}
+
+private:
+    alignas(std::max_align_t) std::array<std::byte, Buff> m_buffer;
+};
+
+///  Trace is handed every production and node the parse goes through, see xml_trace.h.  The default xml_null_trace
+///  compiles to nothing
+template<typename CharT=char, std::size_t Buff = 4096, typename Trace = xml_null_trace>
 class xml_document {
-    using grammar = xml_traits<CharT>;
+    using grammar = xml_traits<CharT, Trace>;
     using view_type = std::basic_string_view<CharT>;
     using node_container = std::pmr::list<xml_node<CharT>>;
     using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
 public:
     xml_document() : m_memresource(std::make_optional<xml_mem_resource<Buff>>()),
-                     m_alloc(&*m_memresource), // address of the object contained by the optional
+                     m_stats(&*m_memresource), // address of the object contained by the optional
+                     m_alloc(&m_stats),
                      m_prolog(node_type::prolog, m_alloc),
                      m_root(node_type::document, m_alloc) {}
 
     explicit xml_document(const view_type v) : m_memresource(std::make_optional<xml_mem_resource<Buff>>()),
-                                               m_alloc(&*m_memresource),
+                                               m_stats(&*m_memresource),
+                                               m_alloc(&m_stats),
                                                m_prolog(node_type::prolog, m_alloc),
                                                m_root(node_type::document, m_alloc) { parse(v); }
 
+    explicit xml_document(parse_mode mode) : xml_document() { m_mode = mode; }
+
+    ///  the document's arena grows as options say
+    explicit xml_document(const xml_arena_options &options) : m_memresource(std::in_place, options),
+                                                              m_stats(&*m_memresource),
+                                                              m_alloc(&m_stats),
+                                                              m_prolog(node_type::prolog, m_alloc),
+                                                              m_root(node_type::document, m_alloc) {}
+
     explicit xml_document(const allocator_type &alloc) : m_memresource(std::nullopt),
-                                                m_alloc(alloc),
+                                                m_stats(alloc.resource()),
+                                                m_alloc(&m_stats),
                                                 m_prolog(node_type::prolog, m_alloc),
                                                 m_root(node_type::document, m_alloc) {}
 
     xml_document(const view_type v, const allocator_type &alloc) : m_memresource(std::nullopt),
-                                                                   m_alloc(alloc),
+                                                                   m_stats(alloc.resource()),
+                                                                   m_alloc(&m_stats),
                                                                    m_prolog(node_type::prolog, m_alloc),
                                                                    m_root(node_type::document, m_alloc) { parse(v); }
 
     std::size_t parse(const std::string &str) { return parse(view_type(str)); };
 
-    std::size_t parse(view_type sv);
+    ///  in parse_mode::view and in_situ the document takes str over so the nodes can keep viewing it
+    std::size_t parse(std::basic_string<CharT> &&str) {
+        auto source = std::make_shared<std::basic_string<CharT>>(std::move(str));
+        auto out = parse(source->data(), source->length());
+        if (m_mode != parse_mode::copy) m_source = std::move(source);
+        return out;
+    }
+
+    ///  in parse_mode::view owner is held for as long as the nodes view sv
+    std::size_t parse(view_type sv, std::shared_ptr<const void> owner) {
+        auto out = parse(sv);
+        if (m_mode != parse_mode::copy) m_source = std::move(owner);
+        return out;
+    }
+
+    ///  sv can not be written to, so parse_mode::in_situ parses it as parse_mode::view
+    std::size_t parse(view_type sv) { return parse(sv, m_mode == parse_mode::in_situ ? parse_mode::view : m_mode); }
 
     std::size_t parse(const CharT *c, std::size_t len) { return parse(view_type(c, len)); };
 
+    ///  in parse_mode::in_situ references are decoded over c as it is parsed, and the nodes view c
+    std::size_t parse(CharT *c, std::size_t len) { return parse(view_type(c, len), m_mode); };
+
+    ///  Parse the file at path straight from a mapping of it, npos when it can not be mapped.  In parse_mode::view and
+    ///  in_situ the nodes keep the mapping alive, in_situ maps it copy on write so the file itself is never changed
+    std::size_t parse_file(const char *path, xml_map_options options = {}) {
+        options.writable = m_mode == parse_mode::in_situ;
+        auto file = std::make_shared<xml_mapped_file>();
+        if (file->open(path, options)) return grammar::npos;
+
+        auto out = options.writable ? parse(file->data<CharT>(), file->size() / sizeof(CharT))
+                                    : parse(file->view<CharT>());
+        if (m_mode != parse_mode::copy) m_source = std::move(file);
+        return out;
+    }
+
+    std::size_t parse_file(const std::string &path, const xml_map_options &options = {}) {
+        return parse_file(path.c_str(), options);
+    }
+
+    ///  Parse sv with the content of the root element cut into parts of about part_size, parsed at once on pool, see
+    ///  xml_thread_pool.h.  The nodes are the ones parse(sv) makes, but the parts allocate from arenas of their own,
+    ///  which stats() does not count.  A document much smaller than part_size is parsed on the calling thread
+    template<typename Pool>
+    std::size_t parse_parallel(view_type sv, Pool &pool, std::size_t part_size = std::size_t(1) << 20u) {
+        return parse(sv, m_mode == parse_mode::in_situ ? parse_mode::view : m_mode, [&](view_type children) {
+            return grammar::Document(&m_root, children, &pool, &m_parts, part_size ? part_size : 1, m_max_depth);
+        });
+    }
+
+    ///  Parse sv in two passes: a structural index of where its markup starts and ends is built first, see
+    ///  xml_index.h, then the productions run on the markup only and the text between is taken from the index without
+    ///  scanning it again.  The nodes are the ones parse(sv) makes.  The index is kept for the next parse
+    std::size_t parse_indexed(view_type sv) {
+        return parse(sv, m_mode == parse_mode::in_situ ? parse_mode::view : m_mode, [&](view_type children) {
+            m_index.build(children);
+            return grammar::Document(&m_root, children, m_index, m_max_depth);
+        });
+    }
+
+    ///  Parse sv lazily.  Elements depth deep are only named and their end found, depth 1 defers the children of the
+    ///  root element and 0 the root itself.  The rest of a deferred element is parsed the first time its children(),
+    ///  attributes() or value() are read, see xml_node::expand, so a document of which only a few branches are read
+    ///  costs little more than finding where its elements end.  Passing over a deferred sibling costs nothing.
+    ///
+    ///  The deferred elements view sv, which must outlive the document, and whatever the mode their text is only
+    ///  checked when they are expanded.  set_max_depth holds across the expansion, each deferred element keeps what its
+    ///  depth leaves of it.  Only expand() profiles what it expands with the document's Trace, reading the nodes does
+    ///  not.  Reading a deferred node changes it, so a lazy document is not to be read from several threads before
+    ///  expand()
+    std::size_t parse_lazy(view_type sv, std::size_t depth = 1) {
+        return parse(sv, m_mode == parse_mode::in_situ ? parse_mode::view : m_mode, [&](view_type children) {
+            return grammar::Document_deferred(&m_root, children, depth, m_max_depth);
+        });
+    }
+
+    ///  the document takes str over, so the deferred elements can keep viewing it
+    std::size_t parse_lazy(std::basic_string<CharT> &&str, std::size_t depth = 1) {
+        auto source = std::make_shared<std::basic_string<CharT>>(std::move(str));
+        auto out = parse_lazy(view_type(*source), depth);
+        m_source = std::move(source);
+        return out;
+    }
+
+    ///  Expand every element a lazy parse deferred, false when one of them does not parse.  Unlike reading the nodes,
+    ///  this parses with the document's Trace, so profile() and stats() take in what is expanded
+    bool expand() {
+        profile_scope profile(&m_profile);
+        bool out = true;
+        std::vector<xml_node<CharT> *> todo{&m_root};
+        while (!todo.empty()) {
+            auto *n = todo.back();
+            todo.pop_back();
+            if (n->deferred()) {
+                out = n->template expand<grammar>() && out;
+                continue;   //  expanded whole, nothing below it is deferred
+            }
+            for (auto &c : n->m_children) todo.push_back(&c);
+        }
+        return out;
+    }
+
+    ///  Drop the parsed nodes.  When the document owns its arena the arena is rewound too, keeping its largest block,
+    ///  so parsing again into the same document reuses the memory instead of piling onto it
     void clear() {
         m_root.clear();
         m_prolog.clear();
+        m_parts.clear();
+        m_source.reset();
+        if (m_atoms && !m_shared_atoms) m_atoms->clear();
+        if (m_memresource) m_memresource->reset();
+    }
+
+    ///  takes effect on the next parse
+    void set_mode(parse_mode mode) { m_mode = mode; }
+
+    ///  Elements nested deeper than depth fail the parse.  Nesting costs no native stack, so this only bounds what a
+    ///  hostile document can make the parse do.  Takes effect on the next parse
+    void set_max_depth(std::size_t depth) { m_max_depth = depth; }
+
+    [[nodiscard]] std::size_t max_depth() const { return m_max_depth; }
+
+    ///  Intern names in atoms, which may be shared with other documents, from the next parse on.  The nodes view the
+    ///  names in the table, so the document is cleared.  Unlike the document's own table, atoms keeps its names from
+    ///  one parse to the next, it grows with every distinct name it is given
+    void share_atoms(std::shared_ptr<xml_atom_table<CharT>> atoms) {
+        clear();
+        m_shared_atoms = atoms != nullptr;
+        m_atoms = std::move(atoms);
+    }
+
+    ///  The table the element and attribute names are interned in, look names up here once to search by atom.  Unless
+    ///  it came from share_atoms it is emptied by clear() and every parse, and atoms found before are no longer valid.
+    ///  Emptying keeps the table's memory, so reparsing documents of the same names allocates nothing for them
+    [[nodiscard]] xml_atom_table<CharT> &atoms() {
+        if (!m_atoms) m_atoms = std::make_shared<xml_atom_table<CharT>>();
+        return *m_atoms;
     }
 
+    [[nodiscard]] parse_mode mode() const { return m_mode; }
+
     const xml_node<CharT> &prolog() const { return m_prolog; };
 
-    const xml_node<CharT> &root() const { return m_prolog; };
+    const xml_node<CharT> &root() const { return m_root; };
 
     const allocator_type &get_alloc() {return m_alloc;}
 
+    ///  What the nodes have allocated since the document was made or reset_stats(), charged to the productions that
+    ///  allocated it when Trace is xml_alloc_trace
+    [[nodiscard]] xml_memory_stats stats() const noexcept { return m_stats.stats(); }
+
+    void reset_stats() noexcept { m_stats.reset_stats(); }
+
+    ///  Calls, bytes and cycles of every production over the parses since the document was made or reset_profile().
+    ///  Only filled in when Trace is xml_profile_trace
+    [[nodiscard]] const xml_parse_profile &profile() const noexcept { return m_profile; }
+
+    void reset_profile() noexcept { m_profile.clear(); }
+
 private:
+    //  a profiling trace counts into this document for the length of a parse or expand
+    struct profile_scope {
+        explicit profile_scope(xml_parse_profile *p) noexcept {
+            if constexpr (xml_trace_profiles<Trace>::value) Trace::attach(p);
+        }
+
+        ~profile_scope() {
+            if constexpr (xml_trace_profiles<Trace>::value) Trace::attach(nullptr);
+        }
+    };
+
+    std::size_t parse(view_type sv, parse_mode mode) {
+        return parse(sv, mode, [this](view_type children) {
+            return grammar::Document(&m_root, children, m_max_depth);
+        });
+    }
+
+    ///  children parses what follows the prolog into m_root
+    template<typename Children>
+    std::size_t parse(view_type sv, parse_mode mode, Children &&children);
+
     std::optional<xml_mem_resource<Buff>> m_memresource;
+    xml_stats_resource m_stats;     //  counts everything the nodes allocate
     allocator_type m_alloc;
+    std::shared_ptr<xml_atom_table<CharT>> m_atoms;     //  outlives the nodes, which view its names
+    bool m_shared_atoms = false;    //  m_atoms came from share_atoms and keeps its names across parses
+    xml_arena_set m_parts;      //  the parts of a parallel parse, which outlive the nodes moved out of them
+    xml_structural_index<CharT> m_index;    //  of the last indexed parse
     xml_node<CharT> m_prolog;
     xml_node<CharT> m_root;
+    parse_mode m_mode = parse_mode::copy;
+    std::size_t m_max_depth = grammar::default_max_depth;
+    std::shared_ptr<const void> m_source;  //  keeps a parse_mode::view source alive
+    xml_parse_profile m_profile;
 };
 
 
-template<typename CharT, std::size_t Buff>
-std::size_t xml_document<CharT, Buff>::parse(view_type sv) {
+template<typename CharT, std::size_t Buff, typename Trace>
+template<typename Children>
+std::size_t xml_document<CharT, Buff, Trace>::parse(view_type sv, parse_mode mode, Children &&children) {
     std::size_t pos = 0;
     // clear any existing contents
     this->clear();
 
+    profile_scope profile(&m_profile);
+    m_prolog.m_mode = mode;
+    m_root.m_mode = mode;
+    m_prolog.m_atoms = m_root.m_atoms = &atoms();
+
     //  Parse BOM
     {
         auto t_out = grammar::BOM(sv);
@@ -355,7 +672,7 @@ std::size_t xml_document<CharT, Buff>::parse(view_type sv) {
 
     //  Parse Children
     {
-        auto t_out = grammar::Document(&m_root, sv.substr(pos));
+        auto t_out = children(sv.substr(pos));
         if (t_out) return static_cast<std::size_t>(t_out);
         pos += t_out;
     }
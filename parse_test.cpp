@@ -0,0 +1,165 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+//  Every way into xml_document against parse() in parse_mode::copy.  Each parse of a corpus document has to build the
+//  same tree, and the prolog, that the copying parse builds.
+//
+//  usage:  parse_test, exits non zero when a parse does not match
+
+#include <string>
+#include <utility>
+#include "jacob_parser.h"
+#include "xml_test.h"
+#include "xml_thread_pool.h"
+
+namespace {
+    using document = xml_document<char>;
+
+    ///  doc against a copying parse of src, parsed is what doc's parse returned
+    void compare(xml_test &t, const std::string &mode, const std::string &src, const document &doc,
+                 const std::size_t parsed) {
+        document ref;
+        const auto expected = ref.parse(src);
+        const auto where = mode + " of " + src.substr(0, 40);
+        if (!t.check(expected == src.length(), where + " : the copying parse failed")) return;
+        if (!t.check(parsed == expected, where + " : parsed " + std::to_string(parsed))) return;
+        auto diff = xml_tree_diff(ref.prolog(), doc.prolog());
+        if (diff.empty()) diff = xml_tree_diff(ref.root(), doc.root());
+        t.check(diff.empty(), where + " : " + diff);
+    }
+
+    void view_mode(xml_test &t) {
+        for (const auto &src : xml_test_corpus()) {
+            document doc(parse_mode::view);
+            const auto parsed = doc.parse(std::string_view(src));
+            compare(t, "parse_mode::view", src, doc, parsed);
+        }
+    }
+
+    ///  in place over a copy of each document, which the nodes view and the decoding writes over
+    void in_situ_mode(xml_test &t) {
+        for (const auto &src : xml_test_corpus()) {
+            std::string buffer(src);
+            document doc(parse_mode::in_situ);
+            const auto parsed = doc.parse(buffer.data(), buffer.length());
+            compare(t, "parse_mode::in_situ", src, doc, parsed);
+        }
+    }
+
+    ///  one document for all, the index is kept from one parse to the next, and what parse() rejects it has to reject
+    void indexed(xml_test &t) {
+        document doc;
+        for (const auto &src : xml_test_corpus()) {
+            const auto parsed = doc.parse_indexed(src);
+            compare(t, "parse_indexed", src, doc, parsed);
+        }
+        for (const char *bad : {"<a><b></a></b>", "<a>", "<a></a>x", "<a>]]></a>", "<a><!-- -- --></a>", "<a b='<'/>",
+                                "<a>&bogus;</a>", "<a>x<", "<a><![CDATA[x]]</a>", "<a><?xml ?></a>"}) {
+            t.check(doc.parse_indexed(bad) == document().parse(std::string_view(bad)), std::string(bad) +
+                    " : parse_indexed differs from parse()");
+        }
+    }
+
+    ///  Deferred at several depths, expanded by expand() or by reading the nodes, which compare() does
+    void lazy(xml_test &t) {
+        for (std::size_t depth : {std::size_t(0), std::size_t(1), std::size_t(2), std::size_t(5)}) {
+            for (const bool whole : {true, false}) {
+                const auto mode = "parse_lazy to depth " + std::to_string(depth) + (whole ? " and expand" : "");
+                for (const auto &src : xml_test_corpus()) {
+                    document doc;
+                    const auto parsed = doc.parse_lazy(src, depth);
+                    const auto where = mode + " of " + src.substr(0, 40);
+                    if (whole && !t.check(doc.expand(), where + " : expand failed")) continue;
+                    compare(t, mode, src, doc, parsed);
+                }
+            }
+        }
+    }
+
+    ///  An element deferred under set_max_depth keeps the limit: the nodes nested past it fail to expand, whether by
+    ///  expand() or by reading the node, and leave the node with its name only
+    void lazy_depth(xml_test &t) {
+        constexpr std::size_t limit = 50;
+        const auto at_limit = xml_test_nested(limit);
+        const auto too_deep = xml_test_nested(limit + 1);
+
+        document doc;
+        doc.set_max_depth(limit);
+        t.check(doc.parse_lazy(at_limit) == at_limit.length(), "parse_lazy failed at the depth limit");
+        t.check(doc.expand(), "expand failed at the depth limit");
+        compare(t, "parse_lazy at the depth limit", at_limit, doc, at_limit.length());
+
+        for (const bool whole : {true, false}) {
+            const std::string how = whole ? "expand()" : "reading the node";
+            document deep;
+            deep.set_max_depth(limit);
+            if (!t.check(deep.parse_lazy(too_deep) == too_deep.length(), "parse_lazy failed past the depth limit")) {
+                continue;
+            }
+            auto &e = deep.root().children().front();
+            t.check(e.children().size() == 1 && e.children().front().deferred(), "the first level was not deferred");
+            auto &deferred = e.children().front();
+            if (whole) t.check(!deep.expand(), how + " expanded past the depth limit");
+            t.check(deferred.children().empty() && !deferred.deferred() && deferred.name() == "e",
+                    how + " left more than the name of a node that failed");
+        }
+    }
+
+    ///  Each way in against set_max_depth: a document nested to the limit parses, one a level deeper fails instead of
+    ///  running out of stack, and one nested a million deep parses under the default limit
+    void depth(xml_test &t) {
+        constexpr auto npos = static_cast<std::size_t>(-1);
+        constexpr std::size_t limit = 100;
+        xml_thread_pool pool(2);
+        const std::pair<const char *, std::size_t (*)(document &, std::string_view, xml_thread_pool &)> ways[] = {
+                {"parse", [](document &d, std::string_view sv, xml_thread_pool &) { return d.parse(sv); }},
+                {"parse_parallel", [](document &d, std::string_view sv, xml_thread_pool &p) {
+                    return d.parse_parallel(sv, p, 64);
+                }},
+                {"parse_indexed", [](document &d, std::string_view sv, xml_thread_pool &) {
+                    return d.parse_indexed(sv);
+                }},
+                {"parse_lazy", [](document &d, std::string_view sv, xml_thread_pool &) {
+                    const auto out = d.parse_lazy(sv);
+                    return out != npos && d.expand() ? out : npos;
+                }},
+        };
+        const auto at_limit = xml_test_nested(limit);
+        const auto too_deep = xml_test_nested(limit + 1);
+        const auto very_deep = xml_test_nested(1000000);
+        for (const auto &[name, way] : ways) {
+            const std::string where = name;
+            document doc;
+            doc.set_max_depth(limit);
+            t.check(way(doc, at_limit, pool) == at_limit.length(), where + " : failed at the depth limit");
+            t.check(way(doc, too_deep, pool) == npos, where + " : parsed past the depth limit");
+            document deep;
+            t.check(way(deep, very_deep, pool) == very_deep.length(), where + " : failed a million deep");
+        }
+    }
+
+    ///  parts small enough that the feed and the deep document are cut into many, and a single part for the rest
+    void parallel(xml_test &t) {
+        xml_thread_pool pool(4);
+        for (std::size_t part_size : {std::size_t(16), std::size_t(64), std::size_t(1) << 20u}) {
+            for (const auto &src : xml_test_corpus()) {
+                document doc;
+                const auto parsed = doc.parse_parallel(src, pool, part_size);
+                compare(t, "parse_parallel in parts of " + std::to_string(part_size), src, doc, parsed);
+            }
+        }
+    }
+}
+
+int main() {
+    xml_test t("parse_test");
+    view_mode(t);
+    in_situ_mode(t);
+    parallel(t);
+    indexed(t);
+    lazy(t);
+    lazy_depth(t);
+    depth(t);
+    return t.report();
+}
@@ -0,0 +1,436 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+//  Throughput of the xml_traits productions one at a time, and of xml_document::parse over a synthetic corpus.
+//  Each production is run over a buffer tiled with the construct it parses, so every call does the same work and
+//  the buffer is walked end to end.  Documents are generated in shapes that stress different parts of the grammar.
+//
+//  usage:  parser_bench [megabytes per buffer]
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "jacob_parser.h"
+#include "xml_batch.h"
+#include "xml_filter.h"
+#include "xml_path.h"
+
+namespace {
+    using grammar = xml_traits<char>;
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    ///  the corpus shapes
+    enum class shape {
+        deep,           //  elements nested thousands deep
+        wide,           //  elements with dozens of attributes
+        huge_text,      //  a few elements with megabytes of text
+        entity_heavy,   //  text and values thick with references
+        comment_heavy,  //  more comment than element
+        pretty          //  an indented record feed, the common case
+    };
+
+    std::ostream &operator<<(std::ostream &lhs, shape rhs) {
+        switch (rhs) {
+            case shape::deep:
+                return lhs << "deep";
+            case shape::wide:
+                return lhs << "wide";
+            case shape::huge_text:
+                return lhs << "huge_text";
+            case shape::entity_heavy:
+                return lhs << "entity_heavy";
+            case shape::comment_heavy:
+                return lhs << "comment_heavy";
+            case shape::pretty:
+                return lhs << "pretty";
+        }
+        return lhs;
+    }
+
+    ///  a document of about bytes in the given shape
+    std::string make_document(shape s, std::size_t bytes) {
+        std::string out = "<?xml version='1.0' encoding='utf-8'?>\n<corpus>";
+        std::size_t n = 0;
+        switch (s) {
+            case shape::deep: {
+                //  nested in runs 2000 deep
+                while (out.length() < bytes) {
+                    std::string close;
+                    for (int d = 0; d < 2000; ++d) {
+                        out += "<level d='" + std::to_string(d) + "'>";
+                        close.insert(0, "</level>");
+                    }
+                    out += "leaf" + close;
+                }
+                break;
+            }
+            case shape::wide:
+                while (out.length() < bytes) {
+                    out += "<row";
+                    for (int a = 0; a < 40; ++a) out += " attribute_" + std::to_string(a) + "=\"value " + std::to_string(n++) + "\"";
+                    out += "/>";
+                }
+                break;
+            case shape::huge_text: {
+                std::string text;
+                while (text.length() < (1u << 20)) text += "the quick brown fox jumps over the lazy dog. ";
+                while (out.length() < bytes) out += "<text>" + text + "</text>";
+                break;
+            }
+            case shape::entity_heavy:
+                while (out.length() < bytes) {
+                    out += "<e v='a&amp;b&lt;c&#x41;'>&lt;tag&gt; &amp;amp; &#169; &#x7EFF; &quot;q&quot; &apos;</e>";
+                }
+                break;
+            case shape::comment_heavy:
+                while (out.length() < bytes) {
+                    out += "<!-- a comment describing the record that follows it, longer than the record -->";
+                    out += "<?audit checked?><r>" + std::to_string(n++) + "</r>";
+                }
+                break;
+            case shape::pretty:
+                while (out.length() < bytes) {
+                    out += "\n  <item id=\"" + std::to_string(n++) + "\" type=\"x\">\n"
+                           "    <title>Item title</title>\n"
+                           "    <price currency=\"EUR\">12.50</price>\n"
+                           "    <tags>\n      <tag>a</tag>\n      <tag>b</tag>\n    </tags>\n"
+                           "  </item>";
+                }
+                out += "\n";
+                break;
+        }
+        out += "</corpus>";
+        return out;
+    }
+
+    std::size_t count_nodes(const xml_node<char> &node) {
+        std::size_t n = 1;
+        for (auto &c : node.children()) n += count_nodes(c);
+        return n;
+    }
+
+    std::string tile(const std::string &unit, std::size_t bytes) {
+        std::string out;
+        out.reserve(bytes + unit.length());
+        while (out.length() < bytes) out += unit;
+        return out;
+    }
+
+    void report(const std::string &name, std::size_t bytes, int reps, double seconds, std::size_t nodes = 0,
+                double allocations = -1) {
+        std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << static_cast<double>(bytes) * reps / seconds / 1e6 << " MB/s";
+        if (nodes) {
+            std::cout << std::setw(10) << std::setprecision(2) << seconds * 1e9 / reps / static_cast<double>(nodes)
+                      << " ns/node";
+            if (allocations >= 0) std::cout << std::setw(10) << allocations << " allocs/node";
+        }
+        std::cout << std::endl;
+    }
+
+    ///  Time parse over buffer until 200 ms have passed.  parse gives the length of one construct, or npos to stop
+    template<typename F>
+    void run_production(const char *name, const std::string &buffer, F &&parse) {
+        const std::string_view sv(buffer);
+        int reps = 0;
+        const auto start = std::chrono::steady_clock::now();
+        auto now = start;
+        do {
+            std::size_t pos = 0;
+            while (pos < sv.length()) {
+                const auto len = parse(sv.substr(pos));
+                if (len == grammar::npos || len == 0) {
+                    std::cout << name << " failed at " << pos << std::endl;
+                    return;
+                }
+                pos += len;
+            }
+            ++reps;
+            now = std::chrono::steady_clock::now();
+        } while (now - start < std::chrono::milliseconds(200));
+        report(name, buffer.length(), reps, std::chrono::duration<double>(now - start).count());
+    }
+
+    ///  a node's worth of arena, rewound after each call
+    struct node_arena {
+        xml_arena_resource arena;
+        allocator_type alloc{&arena};
+    };
+
+    void run_productions(std::size_t bytes) {
+        //  the productions that stop before a separator are tiled with it and step over it
+        run_production("Name", tile("element:name-12 ", bytes), [](std::string_view sv) {
+            auto t_out = grammar::Name(sv);
+            return t_out ? grammar::npos : t_out + 1;
+        });
+        run_production("S", tile(" \t\r\n    x", bytes), [](std::string_view sv) {
+            auto t_out = grammar::S(sv);
+            return t_out ? grammar::npos : t_out + 1;
+        });
+        run_production("Eq", tile("  =  x", bytes), [](std::string_view sv) {
+            auto t_out = grammar::Eq(sv);
+            return t_out ? grammar::npos : t_out + 1;
+        });
+        run_production("AttValue", tile("\"an attribute value &amp; more\"'single'", bytes), [](std::string_view sv) {
+            bool coded;
+            auto t_out = grammar::AttValue(&coded, sv);
+            return t_out ? grammar::npos : static_cast<std::size_t>(t_out);
+        });
+        run_production("Reference", tile("&amp;&lt;&#65;&#x7EFF;&quot;", bytes), [](std::string_view sv) {
+            auto t_out = grammar::Reference(sv);
+            return t_out ? grammar::npos : static_cast<std::size_t>(t_out);
+        });
+        run_production("CharData", tile("character data up to the next markup<", bytes), [](std::string_view sv) {
+            auto t_out = grammar::CharData(sv);
+            return t_out ? grammar::npos : t_out + 1;
+        });
+
+        //  the productions that fill a node get a fresh one each call, the arena under it rewound
+        node_arena a;
+        auto with_node = [&a](node_type nt, auto &&production) {
+            return [&a, nt, production](std::string_view sv) {
+                std::size_t out;
+                {
+                    xml_node<char> node(nt, a.alloc);
+                    auto t_out = production(&node, sv);
+                    out = t_out ? grammar::npos : static_cast<std::size_t>(t_out);
+                }
+                a.arena.reset();
+                return out;
+            };
+        };
+        run_production("Comment", tile("<!-- a comment of moderate length -->", bytes),
+                       with_node(node_type::comment, [](xml_node<char> *n, std::string_view sv) {
+                           return grammar::Comment(n, sv);
+                       }));
+        run_production("PI", tile("<?target some instruction data?>", bytes),
+                       with_node(node_type::pi, [](xml_node<char> *n, std::string_view sv) {
+                           return grammar::PI(n, sv);
+                       }));
+        run_production("CDSect", tile("<![CDATA[raw <text> & more]]>", bytes),
+                       with_node(node_type::cdata, [](xml_node<char> *n, std::string_view sv) {
+                           return grammar::CDSect(n, sv);
+                       }));
+        run_production("Element", tile("<item id='1' type=\"x\"><title>Title &amp; more</title><empty/></item>", bytes),
+                       with_node(node_type::element, [](xml_node<char> *n, std::string_view sv) {
+                           return grammar::Element(n, sv);
+                       }));
+    }
+
+    void run_document(shape s, std::size_t bytes, xml_thread_pool &pool) {
+        const auto text = make_document(s, bytes);
+        const auto body = text.find("<corpus>");
+        const std::string_view children(text.data() + body, text.length() - body);
+
+        //  the Document production alone, over the children after the prolog
+        {
+            node_arena a;
+            int reps = 0;
+            const auto start = std::chrono::steady_clock::now();
+            auto now = start;
+            do {
+                {
+                    xml_node<char> node(node_type::document, a.alloc);
+                    if (grammar::Document(&node, children)) {
+                        std::cout << "Document failed on " << s << std::endl;
+                        return;
+                    }
+                }
+                a.arena.reset();
+                ++reps;
+                now = std::chrono::steady_clock::now();
+            } while (now - start < std::chrono::milliseconds(200));
+            std::ostringstream name;
+            name << "Document " << s;
+            report(name.str(), children.length(), reps, std::chrono::duration<double>(now - start).count());
+        }
+
+        //  the whole parse, into one document reused the way a server would
+        xml_document<char> doc;
+        if (doc.parse(text) != text.length()) {
+            std::cout << "parse failed on " << s << std::endl;
+            return;
+        }
+        const auto nodes = count_nodes(doc.prolog()) + count_nodes(doc.root());
+        doc.reset_stats();
+
+        int reps = 0;
+        const auto start = std::chrono::steady_clock::now();
+        auto now = start;
+        do {
+            doc.parse(text);
+            ++reps;
+            now = std::chrono::steady_clock::now();
+        } while (now - start < std::chrono::milliseconds(200));
+
+        const auto allocations = static_cast<double>(doc.stats().allocations) / reps / static_cast<double>(nodes);
+        std::ostringstream name;
+        name << "parse " << s;
+        report(name.str(), text.length(), reps, std::chrono::duration<double>(now - start).count(), nodes, allocations);
+
+        //  the structural index alone, then the same parse driven by it
+        {
+            xml_structural_index<char> index;
+            reps = 0;
+            const auto istart = std::chrono::steady_clock::now();
+            now = istart;
+            do {
+                index.build(children);
+                ++reps;
+                now = std::chrono::steady_clock::now();
+            } while (now - istart < std::chrono::milliseconds(200));
+            std::ostringstream iname;
+            iname << "index " << s;
+            report(iname.str(), children.length(), reps, std::chrono::duration<double>(now - istart).count());
+        }
+        if (doc.parse_indexed(std::string_view(text)) != text.length()) {
+            std::cout << "indexed parse failed on " << s << std::endl;
+            return;
+        }
+        reps = 0;
+        const auto xstart = std::chrono::steady_clock::now();
+        now = xstart;
+        do {
+            doc.parse_indexed(std::string_view(text));
+            ++reps;
+            now = std::chrono::steady_clock::now();
+        } while (now - xstart < std::chrono::milliseconds(200));
+        std::ostringstream xname;
+        xname << "parse_indexed " << s;
+        report(xname.str(), text.length(), reps, std::chrono::duration<double>(now - xstart).count(), nodes);
+
+        //  the same, the root's content cut into parts for the pool
+        const std::size_t part_size = std::max<std::size_t>(text.length() / (pool.size() * 4), 64 * 1024);
+        if (doc.parse_parallel(std::string_view(text), pool, part_size) != text.length()) {
+            std::cout << "parallel parse failed on " << s << std::endl;
+            return;
+        }
+        reps = 0;
+        const auto pstart = std::chrono::steady_clock::now();
+        now = pstart;
+        do {
+            doc.parse_parallel(std::string_view(text), pool, part_size);
+            ++reps;
+            now = std::chrono::steady_clock::now();
+        } while (now - pstart < std::chrono::milliseconds(200));
+        std::ostringstream pname;
+        pname << "parse_parallel " << s;
+        report(pname.str(), text.length(), reps, std::chrono::duration<double>(now - pstart).count(), nodes);
+    }
+
+    ///  compiled paths selecting from a parsed document, the node set reused between selections
+    void run_paths(std::size_t bytes) {
+        const auto text = make_document(shape::pretty, bytes);
+        xml_document<char> doc;
+        if (doc.parse(text) != text.length()) return;
+        const auto nodes = count_nodes(doc.root());
+
+        xml_node_set<char> set;
+        for (const char *expr : {"/corpus/item", "/corpus/item[@type='x']/price", "//tag", "//item[2]/tags/tag[1]"}) {
+            const xml_path<char> path(expr);
+            int reps = 0;
+            const auto start = std::chrono::steady_clock::now();
+            auto now = start;
+            do {
+                path.select(doc.root(), &set);
+                ++reps;
+                now = std::chrono::steady_clock::now();
+            } while (now - start < std::chrono::milliseconds(200));
+            std::ostringstream name;
+            name << "select " << expr;
+            report(name.str(), text.length(), reps, std::chrono::duration<double>(now - start).count(), nodes);
+        }
+
+        //  the same selections streamed, only the matches are built
+        for (const char *expr : {"/corpus/item[@type='x']/price", "//item[2]/tags/tag[1]"}) {
+            xml_subtree_filter<char> filter({xml_path<char>(expr)});
+            int reps = 0;
+            const auto start = std::chrono::steady_clock::now();
+            auto now = start;
+            do {
+                filter.parse(std::string_view(text), [](std::size_t, const xml_node<char> &) {});
+                ++reps;
+                now = std::chrono::steady_clock::now();
+            } while (now - start < std::chrono::milliseconds(200));
+            std::ostringstream name;
+            name << "filter " << expr;
+            report(name.str(), text.length(), reps, std::chrono::duration<double>(now - start).count());
+        }
+    }
+
+    ///  a document of which one branch is read, parsed whole and lazily
+    void run_lazy(std::size_t bytes) {
+        const auto text = make_document(shape::pretty, bytes);
+        xml_document<char> doc;
+        for (bool lazy : {false, true}) {
+            int reps = 0;
+            const auto start = std::chrono::steady_clock::now();
+            auto now = start;
+            do {
+                if (lazy) doc.parse_lazy(std::string_view(text)); else doc.parse(text);
+                const auto &items = doc.root().children().front().children();
+                auto it = items.begin();
+                std::advance(it, items.size() / 2);
+                count_nodes(*it);
+                ++reps;
+                now = std::chrono::steady_clock::now();
+            } while (now - start < std::chrono::milliseconds(200));
+            report(lazy ? "parse_lazy one branch" : "parse one branch", text.length(), reps,
+                   std::chrono::duration<double>(now - start).count());
+        }
+    }
+
+    ///  many small documents, one after another into one document and then as a batch on the pool
+    void run_batch(xml_thread_pool &pool) {
+        std::vector<std::string> docs;
+        std::size_t bytes = 0;
+        for (std::size_t i = 0; i < 4096; ++i) {
+            docs.push_back(make_document(shape::pretty, 1024 + (i * 7919) % (19 * 1024)));
+            bytes += docs.back().length();
+        }
+
+        xml_document<char> doc;
+        int reps = 0;
+        auto start = std::chrono::steady_clock::now();
+        auto now = start;
+        do {
+            for (auto &d : docs) doc.parse(d);
+            ++reps;
+            now = std::chrono::steady_clock::now();
+        } while (now - start < std::chrono::milliseconds(200));
+        report("documents one by one", bytes, reps, std::chrono::duration<double>(now - start).count());
+
+        for (bool ordered : {false, true}) {
+            xml_batch_parser<char> batch(pool, {16, ordered});
+            reps = 0;
+            start = std::chrono::steady_clock::now();
+            do {
+                batch.parse(docs);
+                ++reps;
+                now = std::chrono::steady_clock::now();
+            } while (now - start < std::chrono::milliseconds(200));
+            report(ordered ? "documents batch ordered" : "documents batch", bytes, reps,
+                   std::chrono::duration<double>(now - start).count());
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    const std::size_t mb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+    const std::size_t bytes = (mb ? mb : 4) << 20u;
+
+    std::cout << "detected kernel : " << xml_scan_dispatch::level() << std::endl;
+    run_productions(bytes);
+    xml_thread_pool pool;
+    for (auto s : {shape::deep, shape::wide, shape::huge_text, shape::entity_heavy, shape::comment_heavy, shape::pretty})
+        run_document(s, bytes, pool);
+    run_batch(pool);
+    run_paths(bytes);
+    run_lazy(bytes);
+    return 0;
+}
@@ -0,0 +1,175 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+//  xml_path over the record feed of the corpus.  Each path has to select the elements its steps and predicates name,
+//  no others, in document order.  Paths that do not compile have to select nothing.
+//
+//  xml_subtree_filter over every corpus document against xml_path::select over the parsed tree.  Given a few paths at
+//  once the filter has to hand over what the paths select, in document order, each element once for every path that
+//  selects it, less what lies inside an element handed over before, and each as the tree parse() builds of it.
+//
+//  usage:  path_test, exits non zero when a selection differs
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "jacob_parser.h"
+#include "xml_filter.h"
+#include "xml_path.h"
+#include "xml_test.h"
+
+namespace {
+    using document = xml_document<char>;
+
+    constexpr int items = 200;  //  in the feed, item i has id i and type y when i % 3 is 0, else x
+
+    std::string feed() {
+        for (auto &src : xml_test_corpus()) if (src.find("<feed>") != std::string::npos) return src;
+        return std::string();
+    }
+
+    ///  an element as the checks write it, name#id when it has an id, else name=value
+    std::string describe(const xml_node<char> &node) {
+        for (auto &a : node.attributes()) {
+            if (a.first.view() == "id") return std::string(node.name()) + '#' + std::string(a.second.view());
+        }
+        return std::string(node.name()) + '=' + std::string(node.value());
+    }
+
+    std::string selected(const document &doc, const std::string &expr) {
+        xml_path<char> path(expr);
+        xml_node_set<char> set;
+        std::string out;
+        for (auto *node : path.select(doc.root(), &set)) out += describe(*node) + ' ';
+        return out;
+    }
+
+    ///  what of(i) writes of each item i for which keep(i), in document order
+    template<typename Keep, typename Of>
+    std::string expect(Keep keep, Of of) {
+        std::string out;
+        for (int i = 0; i < items; ++i) if (keep(i)) out += of(std::to_string(i));
+        return out;
+    }
+
+    std::string item(const std::string &n) { return "item#" + n + ' '; }
+
+    void paths(xml_test &t, const document &doc) {
+        const auto all = [](int) { return true; };
+        const auto y = [](int i) { return i % 3 == 0; };
+        const auto x = [](int i) { return i % 3 != 0; };
+        const std::pair<std::string, std::string> cases[] = {
+                {"//item[2]/tags/tag[1]", "tag=a1 "},
+                {"/feed/item[1]", "item#0 "},
+                {"/feed/item", expect(all, item)},
+                {"//item", expect(all, item)},
+                {"//item[@id]", expect(all, item)},
+                {"//item[@missing]", ""},
+                {"//item[@type='y']", expect(y, item)},
+                {"//item[@type!='y']", expect(x, item)},
+                {"//item[@type='x'][2]", "item#2 "},
+                {"//item[2][@type='x']", "item#1 "},
+                {"//item[1][@type='x']", ""},
+                {"//item[@id='150']/title", "title=Title 150 & more "},
+                {"/feed/*/title", expect(all, [](const std::string &n) { return "title=Title " + n + " & more "; })},
+                {"feed//title", expect(all, [](const std::string &n) { return "title=Title " + n + " & more "; })},
+                {"//tags/*[2]", expect(all, [](const std::string &n) { return "tag=b" + n + ' '; })},
+                {"//tag", expect(all, [](const std::string &n) { return "tag=a" + n + " tag=b" + n + ' '; })},
+                {"//item[@type='y']//tag[2]", expect(y, [](const std::string &n) { return "tag=b" + n + ' '; })},
+                {"/item", ""},
+                {"//nothing", ""},
+                {"//item[", ""},
+                {"//item[@type='y'", ""},
+                {"", ""},
+        };
+        for (auto &[expr, expected] : cases) {
+            const auto got = selected(doc, expr);
+            t.check(got == expected, expr + " selected " + got.substr(0, 200));
+        }
+    }
+
+    ///  a selected element and the path that selected it
+    struct match {
+        std::size_t path;
+        const xml_node<char> *node;
+    };
+
+    ///  what a filter of paths should hand over from doc: the elements the paths select, in document order and by path
+    ///  for an element several select, leaving out those inside an element already handed over
+    std::vector<match> expect_matches(const document &doc, const std::vector<std::string> &paths) {
+        std::vector<xml_node_set<char>> sets(paths.size());
+        for (std::size_t p = 0; p < paths.size(); ++p) xml_path<char>(paths[p]).select(doc.root(), &sets[p]);
+
+        std::vector<match> out;
+        std::vector<const xml_node<char> *> todo{&doc.root()};
+        while (!todo.empty()) {
+            const auto *node = todo.back();
+            todo.pop_back();
+            bool selected = false;
+            for (std::size_t p = 0; p < sets.size(); ++p) {
+                for (auto *s : sets[p]) {
+                    if (s != node) continue;
+                    out.push_back({p, node});
+                    selected = true;
+                }
+            }
+            if (selected) continue;
+            const auto &children = node->children();
+            for (auto c = children.rbegin(); c != children.rend(); ++c) {
+                if (c->type() == node_type::element) todo.push_back(&*c);
+            }
+        }
+        return out;
+    }
+
+    void filter(xml_test &t) {
+        const std::vector<std::vector<std::string>> path_sets{
+                {"//item[2]/tags/tag[1]", "//item[@type='y']/title", "//tags", "//tag[2]"},
+                {"/feed/item[@id='7']", "//item[@id='7']//tag", "//item[@id='9']//tag"},
+                {"//item[3]", "/feed/item[3]", "/feed/*[@type!='x'][2]"},
+                {"//b", "//x", "//z[@k]", "/root/*[2]", "/a/*[3]", "//d3[@n='10']", "//d5[@n='299']"},
+                {"/*"},
+        };
+        for (const auto &src : xml_test_corpus()) {
+            document doc;
+            if (!t.check(doc.parse(src) == src.length(), src.substr(0, 40) + " did not parse")) continue;
+            for (const auto &paths : path_sets) {
+                const auto expected = expect_matches(doc, paths);
+                xml_subtree_filter<char> filter;
+                for (const auto &p : paths) filter.add(xml_path<char>(p));
+
+                std::size_t k = 0;
+                const auto where = paths.front() + " ... over " + src.substr(0, 40);
+                const auto parsed = filter.parse(src, [&](std::size_t path, const xml_node<char> &node) {
+                    const auto at = where + " : match " + std::to_string(k);
+                    if (!t.check(k < expected.size(), at + " " + describe(node) + " was not expected")) return;
+                    const auto &e = expected[k++];
+                    if (!t.check(path == e.path, at + " is of path " + std::to_string(path))) return;
+                    const auto diff = xml_tree_diff(*e.node, node);
+                    t.check(diff.empty(), at + " " + describe(*e.node) + " : " + diff);
+                });
+                t.check(parsed == src.length(), where + " : filtered " + std::to_string(parsed));
+                t.check(k == expected.size(), where + " : " + std::to_string(k) + " of " +
+                                              std::to_string(expected.size()) + " matches handed over");
+            }
+        }
+    }
+
+    void invalid(xml_test &t) {
+        for (const char *expr : {"//item[", "//item[@type='y'", "", "//", "item[0x]", "item/"}) {
+            t.check(!xml_path<char>(expr).valid(), std::string(expr) + " compiled");
+        }
+    }
+}
+
+int main() {
+    xml_test t("path_test");
+    document doc;
+    const auto src = feed();
+    if (!t.check(doc.parse(src) == src.length(), "the feed did not parse")) return t.report();
+    paths(t, doc);
+    invalid(t);
+    filter(t);
+    return t.report();
+}
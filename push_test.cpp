@@ -0,0 +1,82 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+//  xml_push_parser fed a document a piece at a time, down to a byte per feed, against xml_sax_parser given it whole.
+//  The events have to be the same and finish() has to return the length the sax parse returns.  The documents
+//  are cut inside names, quoted values holding '>', references, "]]>", "-->" and "?>", where the held back tail of
+//  a feed has to be picked up again.
+//
+//  usage:  push_test, exits non zero when a check fails
+
+#include <string>
+#include "jacob_parser.h"
+#include "xml_push.h"
+#include "xml_sax.h"
+#include "xml_test.h"
+
+namespace {
+    constexpr auto npos = static_cast<std::size_t>(-1);
+
+    std::vector<std::string> documents() {
+        auto out = xml_test_corpus();
+        out.emplace_back("<?xml version=\"1.0\" standalone='yes'?>\n"
+                         "<longelementname attribute=\"a > b\" other='c>d'>x &amp; y &#x41;&#66;&lt;z]"
+                         "<![CDATA[ ]] ]]]><!-- - ->--><?target a?b ?>]] ]</longelementname>");
+        out.emplace_back("<a>&quot;&apos;&amp;&lt;&gt;</a>");
+        out.emplace_back("<a b=\"&amp;&lt;\">]</a>");
+        for (const char *bad : {"<a><b></a></b>", "<a>", "<a></a>x", "<a>]]></a>", "<a><!-- -- --></a>",
+                                "<a>&bogus;</a>", "<a></b>", "<a b='>'", "<a><![CDATA[x]]</a>"}) {
+            out.emplace_back(bad);
+        }
+        return out;
+    }
+
+    void pieces(xml_test &t) {
+        for (const auto &src : documents()) {
+            xml_test_events expected;
+            xml_sax_parser<char, xml_test_events> sax(expected);
+            const auto length = sax.parse(src);
+            expected.flush();
+
+            for (std::size_t size : {std::size_t(1), std::size_t(2), std::size_t(3), std::size_t(7),
+                                     std::size_t(64), src.length()}) {
+                xml_test_events events;
+                xml_push_parser<char, xml_test_events> push(events);
+                bool ok = true;
+                for (std::size_t at = 0; ok && at < src.length(); at += size) {
+                    ok = push.feed(std::string_view(src).substr(at, size));
+                }
+                const auto parsed = push.finish();
+                events.flush();
+
+                const auto where = src.substr(0, 40) + " fed " + std::to_string(size) + " at a time";
+                t.check(parsed == length, where + " : finished at " + std::to_string(parsed) + " expected " +
+                                          std::to_string(length));
+                //  the events before an error depend on how far each parser got
+                if (length != npos) t.check(events.log == expected.log, where + " : the events differ:\n" + events.log);
+            }
+        }
+    }
+
+    void reset(xml_test &t) {
+        xml_test_events events;
+        xml_push_parser<char, xml_test_events> push(events);
+        push.feed("<a><b");
+        push.finish();
+        push.reset();
+        events.log.clear();
+        const std::string src = "<c>d</c>";
+        for (const auto c : src) push.feed(std::string_view(&c, 1));
+        t.check(push.finish() == src.length(), "a reset parser did not parse a new document");
+        events.flush();
+        t.check(events.log == "start c\ntext d\nend c\n", "a reset parser's events differ:\n" + events.log);
+    }
+}
+
+int main() {
+    xml_test t("push_test");
+    pieces(t);
+    reset(t);
+    return t.report();
+}
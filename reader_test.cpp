@@ -0,0 +1,134 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+//  xml_reader: the tokens of every corpus document in the order xml_sax_parser hands over its events, skip_subtree
+//  passing over a whole element and carrying on after it, and broken documents ending in an error token.
+//
+//  usage:  reader_test, exits non zero when a check fails
+
+#include <sstream>
+#include <string>
+#include "jacob_parser.h"
+#include "xml_reader.h"
+#include "xml_sax.h"
+#include "xml_test.h"
+
+namespace {
+    using reader = xml_reader<char>;
+
+    ///  replay the tokens of r into events, the last token is returned
+    xml_token replay(reader &r, xml_test_events *events) {
+        for (;;) {
+            switch (r.next()) {
+                case xml_token::xml_declaration:
+                    events->xml_declaration(r.attributes());
+                    break;
+                case xml_token::start_element:
+                    events->start_element(r.name(), r.attributes());
+                    break;
+                case xml_token::end_element:
+                    events->end_element(r.name());
+                    break;
+                case xml_token::text:
+                    events->characters(r.value());
+                    break;
+                case xml_token::comment:
+                    events->comment(r.value());
+                    break;
+                case xml_token::pi:
+                    events->pi(r.name(), r.value());
+                    break;
+                case xml_token::cdata:
+                    events->cdata(r.value());
+                    break;
+                default:
+                    events->flush();
+                    return r.token();
+            }
+        }
+    }
+
+    void same_as_sax(xml_test &t) {
+        for (const auto &src : xml_test_corpus()) {
+            xml_test_events expected;
+            xml_sax_parser<char, xml_test_events> sax(expected);
+            sax.parse(src);
+            expected.flush();
+
+            xml_test_events events;
+            reader r(src);
+            const auto last = replay(r, &events);
+            t.check(last == xml_token::end_document, src.substr(0, 40) + " : did not read to the end");
+            t.check(r.offset() == src.length(), src.substr(0, 40) + " : stopped short");
+            t.check(events.log == expected.log, src.substr(0, 40) + " : the tokens differ:\n" + events.log);
+        }
+    }
+
+    ///  tokens as "token name" lines, with every start element skipped whose name is skip
+    std::string skipping(const std::string &src, const std::string &skip) {
+        std::ostringstream out;
+        reader r(src);
+        for (auto tok = r.next(); tok != xml_token::end_document && tok != xml_token::error; tok = r.next()) {
+            out << tok << ' ' << r.name() << ' ' << r.depth() << '\n';
+            if (tok == xml_token::start_element && r.name() == skip) {
+                if (!r.skip_subtree()) break;
+                out << r.token() << ' ' << r.name() << ' ' << r.depth() << '\n';
+            }
+        }
+        out << r.token() << '\n';
+        return out.str();
+    }
+
+    void skip_subtree(xml_test &t) {
+        const std::string src = "<r><a x=\"1\"><b>t<![CDATA[</a>]]><!--</a>--><c q='>'/></b></a><a/><d>u</d></r>";
+        const std::string expected = "Start Element Token r 1\n"
+                                     "Start Element Token a 2\n"
+                                     "End Element Token a 1\n"
+                                     "Start Element Token a 2\n"
+                                     "End Element Token a 1\n"
+                                     "Start Element Token d 2\n"
+                                     "Text Token  2\n"
+                                     "End Element Token d 1\n"
+                                     "End Element Token r 0\n"
+                                     "End Document Token\n";
+        const auto got = skipping(src, "a");
+        t.check(got == expected, "skip_subtree order differs:\n" + got);
+
+        //  skipping the root leaves nothing but the end
+        const auto root = skipping(src, "r");
+        t.check(root == "Start Element Token r 1\nEnd Element Token r 0\nEnd Document Token\n",
+                "skipping the root differs:\n" + root);
+
+        //  every item of the feed passed over
+        std::string feed;
+        for (auto &src : xml_test_corpus()) if (src.find("<feed>") != std::string::npos) feed = src;
+        reader r(feed);
+        int items = 0;
+        for (auto tok = r.next(); tok != xml_token::end_document && tok != xml_token::error; tok = r.next()) {
+            if (tok == xml_token::start_element && r.name() == "item") {
+                ++items;
+                r.skip_subtree();
+            }
+        }
+        t.check(r.token() == xml_token::end_document && items == 200,
+                "skipping the feed's items read " + std::to_string(items));
+    }
+
+    void errors(xml_test &t) {
+        for (const char *bad : {"<a><b></a></b>", "<a>", "<a></a>x", "<a>]]></a>", "<a>&bogus</a>", "<a></b>"}) {
+            xml_test_events events;
+            reader r{std::string_view(bad)};
+            t.check(replay(r, &events) == xml_token::error, std::string(bad) + " : read without an error");
+            t.check(r.next() == xml_token::error, std::string(bad) + " : the error is not final");
+        }
+    }
+}
+
+int main() {
+    xml_test t("reader_test");
+    same_as_sax(t);
+    skip_subtree(t);
+    errors(t);
+    return t.report();
+}
@@ -0,0 +1,85 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+//  xml_sax_parser: the events of a document in order, the same documents accepted and rejected as xml_document, and
+//  nesting far past what recursion could take with the depth limit failing the parse instead of the stack.
+//
+//  usage:  sax_test, exits non zero when a check fails
+
+#include <string>
+#include "jacob_parser.h"
+#include "xml_sax.h"
+#include "xml_test.h"
+
+namespace {
+    constexpr auto npos = static_cast<std::size_t>(-1);
+
+    std::size_t sax_parse(const std::string &src, xml_test_events *events, std::size_t max_depth = npos) {
+        xml_sax_parser<char, xml_test_events> sax(*events);
+        if (max_depth != npos) sax.set_max_depth(max_depth);
+        const auto out = sax.parse(src);
+        events->flush();
+        return out;
+    }
+
+    void event_order(xml_test &t) {
+        const std::string src = "<?xml version=\"1.0\"?><!--c--><r a=\"1\" b='x&amp;y'>t&lt;<e/>"
+                                "<![CDATA[<d>]]><?p q r?>&#65;u<f g=\"&quot;\">v</f></r><!--z-->";
+        const std::string expected = "decl \n  version=1.0\n"
+                                     "comment c\n"
+                                     "start r\n  a=1\n  b=x&y\n"
+                                     "text t<\n"
+                                     "start e\n"
+                                     "end e\n"
+                                     "cdata <d>\n"
+                                     "pi p q r\n"
+                                     "text Au\n"
+                                     "start f\n  g=\"\n"
+                                     "text v\n"
+                                     "end f\n"
+                                     "end r\n"
+                                     "comment z\n";
+        xml_test_events events;
+        t.check(sax_parse(src, &events) == src.length(), "the event document did not parse");
+        t.check(events.log == expected, "the events differ:\n" + events.log);
+    }
+
+    ///  accepted where xml_document accepts, with the same length, and rejected where it rejects
+    void same_documents(xml_test &t) {
+        auto documents = xml_test_corpus();
+        for (const char *bad : {"<a><b></a></b>", "<a>", "<a></a>x", "<a>]]></a>", "<a x='1' x='2'/>",
+                                "<a><!-- - -- --></a>", "<a>&#;</a>", "text", "<a></b>", "<a b=\"<\"/>", "<a/><b/>x"}) {
+            documents.emplace_back(bad);
+        }
+        for (const auto &src : documents) {
+            xml_document<char> doc;
+            xml_test_events events;
+            const auto expected = doc.parse(src);
+            const auto parsed = sax_parse(src, &events);
+            t.check(parsed == expected, src.substr(0, 40) + " : parsed " + std::to_string(parsed) + " expected " +
+                                        std::to_string(expected));
+        }
+    }
+
+    void depth(xml_test &t) {
+        const auto deep = xml_test_nested(1000000);
+        xml_test_events events;
+        t.check(sax_parse(deep, &events) == deep.length(), "a document nested 1000000 deep did not parse");
+
+        const auto five = xml_test_nested(5);
+        xml_test_events limited;
+        t.check(sax_parse(five, &limited, 4) == npos, "a document nested past max_depth parsed");
+        xml_test_events exact;
+        t.check(sax_parse(five, &exact, 5) == five.length(), "a document nested to max_depth did not parse");
+        t.check(sax_parse(deep, &limited, 1000) == npos, "a document nested 1000000 deep parsed with max_depth 1000");
+    }
+}
+
+int main() {
+    xml_test t("sax_test");
+    event_order(t);
+    same_documents(t);
+    depth(t);
+    return t.report();
+}
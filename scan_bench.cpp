@@ -0,0 +1,84 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+//  Throughput of xml_scan for every character class, kernel and code unit width.
+//  Each buffer is filled with code units the scan never stops on, so every run walks the whole buffer.
+//
+//  usage:  scan_bench [megabytes per buffer]
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "xml_constants.h"
+
+namespace {
+
+    template<typename CharT, bool FO, constant cnst>
+    std::basic_string<CharT> make_buffer(std::size_t len) {
+        using set = xml_constant<CharT, FO, cnst>;
+        std::basic_string<CharT> out(len, CharT(0));
+
+        //  gather the code units the scan passes over, then tile them
+        std::basic_string<CharT> pass;
+        for (unsigned c = 1; c < 128; ++c) {
+            if (!set::stop_set.test(static_cast<std::uint8_t>(c))) pass.push_back(CharT(c));
+        }
+        for (std::size_t i = 0; i < len; ++i) out[i] = pass[(i * 7) % pass.length()];
+        return out;
+    }
+
+    template<typename CharT, bool FO, constant cnst>
+    void run(const char *width, std::size_t bytes) {
+        using set = xml_constant<CharT, FO, cnst>;
+        const auto buffer = make_buffer<CharT, FO, cnst>(bytes / sizeof(CharT));
+
+        for (auto l : {scan_level::scalar, scan_level::sse42, scan_level::avx2, scan_level::avx512}) {
+            if (!xml_scan_dispatch::supported(l)) continue;
+
+            std::size_t sink = 0;
+            int reps = 0;
+            const auto start = std::chrono::steady_clock::now();
+            auto now = start;
+            do {
+                sink += xml_scan<CharT>::find(buffer.data(), buffer.length(), set::stop_set, l);
+                ++reps;
+                now = std::chrono::steady_clock::now();
+            } while (now - start < std::chrono::milliseconds(200));
+
+            const double seconds = std::chrono::duration<double>(now - start).count();
+            const double gbs = static_cast<double>(bytes) * reps / seconds / 1e9;
+            std::cout << std::left << std::setw(16) << cnst
+                      << std::setw(6) << (FO ? "of" : "not")
+                      << std::setw(10) << width
+                      << std::setw(8) << l
+                      << std::right << std::fixed << std::setprecision(2) << std::setw(8) << gbs << " GB/s"
+                      << (sink == 0 ? " !" : "") << std::endl;
+        }
+    }
+
+    template<typename CharT>
+    void run_all(const char *width, std::size_t bytes) {
+        run<CharT, true, constant::CharData>(width, bytes);
+        run<CharT, true, constant::AttValue_quot>(width, bytes);
+        run<CharT, true, constant::AttValue_apos>(width, bytes);
+        run<CharT, true, constant::CharComment>(width, bytes);
+        run<CharT, true, constant::CharPI>(width, bytes);
+        run<CharT, true, constant::CharCDATA>(width, bytes);
+        run<CharT, true, constant::NameChar>(width, bytes);
+        run<CharT, false, constant::S>(width, bytes);
+    }
+}
+
+int main(int argc, char **argv) {
+    const std::size_t mb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+    const std::size_t bytes = (mb ? mb : 16) << 20u;
+
+    std::cout << "detected kernel : " << xml_scan_dispatch::level() << std::endl;
+    run_all<char>("char", bytes);
+    run_all<char16_t>("char16_t", bytes);
+    run_all<char32_t>("char32_t", bytes);
+    return 0;
+}
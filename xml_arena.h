@@ -0,0 +1,230 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_ARENA_H
+#define PARSER_XML_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory_resource>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+///  where an xml_arena_resource gets its blocks
+enum class xml_arena_backing : std::uint8_t {
+    upstream,   //  the upstream memory_resource, new_delete_resource by default
+    mmap,       //  anonymous mappings of whole pages
+    hugepages   //  anonymous mappings in 2 MB steps, advised MADV_HUGEPAGE
+};
+
+std::ostream &operator<<(std::ostream &lhs, xml_arena_backing rhs) {
+    switch (rhs) {
+        case xml_arena_backing::upstream:
+            return lhs << "Upstream Backing";
+        case xml_arena_backing::mmap:
+            return lhs << "Mmap Backing";
+        case xml_arena_backing::hugepages:
+            return lhs << "Hugepage Backing";
+    }
+    return lhs;
+}
+
+struct xml_arena_options {
+    std::size_t initial_block = 64 * 1024;          //  the first block taken from the backing
+    std::size_t max_block = 64 * 1024 * 1024;       //  blocks double up to here, one larger request gets its own block
+    xml_arena_backing backing = xml_arena_backing::upstream;
+};
+
+///  A monotonic arena for parsed documents.  Memory is handed out from a chain of blocks, each twice the size of the
+///  last up to max_block, and only given back all at once.  reset() rewinds it for the next document and keeps the
+///  largest block, so once an arena has grown to fit the documents it parses it stops allocating altogether.
+///
+///  An arena may start from a buffer it does not own, which is used before any block is taken from the backing.
+///  It is not thread safe, one arena belongs to one document.
+class xml_arena_resource : public std::pmr::memory_resource {
+public:
+    explicit xml_arena_resource(const xml_arena_options &options = {},
+                                std::pmr::memory_resource *upstream = std::pmr::new_delete_resource()) :
+            m_options(options), m_upstream(upstream), m_next_size(options.initial_block) {}
+
+    ///  buffer, size bytes, is used first and never freed
+    xml_arena_resource(void *buffer, std::size_t size, const xml_arena_options &options = {},
+                       std::pmr::memory_resource *upstream = std::pmr::new_delete_resource()) :
+            xml_arena_resource(options, upstream) {
+        m_buffer = static_cast<std::byte *>(buffer);
+        m_buffer_size = size;
+        m_ptr = m_buffer;
+        m_end = m_buffer + size;
+    }
+
+    xml_arena_resource(const xml_arena_resource &) = delete;
+
+    xml_arena_resource &operator=(const xml_arena_resource &) = delete;
+
+    ~xml_arena_resource() override { release(); }
+
+    ///  Forget everything allocated.  The largest block is kept and the rest given back, the next document starts in
+    ///  the kept block, or the buffer when no block was ever taken
+    void reset() noexcept {
+        block *largest = nullptr;
+        for (auto b = m_current; b; b = b->prev) if (!largest || b->size > largest->size) largest = b;
+        for (auto b = m_current; b;) {
+            const auto prev = b->prev;
+            if (b != largest) free_block(b);
+            b = prev;
+        }
+        m_current = largest;
+        if (largest) {
+            largest->prev = nullptr;
+            m_capacity = largest->size;
+            m_ptr = reinterpret_cast<std::byte *>(largest + 1);
+            m_end = reinterpret_cast<std::byte *>(largest) + largest->size;
+        } else {
+            m_capacity = 0;
+            m_ptr = m_buffer;
+            m_end = m_buffer + m_buffer_size;
+        }
+        m_used = 0;
+    }
+
+    ///  give every block back
+    void release() noexcept {
+        for (auto b = m_current; b;) {
+            const auto prev = b->prev;
+            free_block(b);
+            b = prev;
+        }
+        m_current = nullptr;
+        m_capacity = 0;
+        m_ptr = m_buffer;
+        m_end = m_buffer + m_buffer_size;
+        m_used = 0;
+        m_next_size = m_options.initial_block;
+    }
+
+    ///  bytes allocated since the last reset
+    [[nodiscard]] std::size_t used() const noexcept { return m_used; }
+
+    ///  bytes held in blocks taken from the backing
+    [[nodiscard]] std::size_t capacity() const noexcept { return m_capacity; }
+
+    [[nodiscard]] const xml_arena_options &options() const noexcept { return m_options; }
+
+private:
+    struct alignas(std::max_align_t) block {
+        block *prev;
+        std::size_t size;   //  including this header
+    };
+
+    static std::byte *align_up(std::byte *p, std::size_t alignment) noexcept {
+        const auto v = reinterpret_cast<std::uintptr_t>(p);
+        return reinterpret_cast<std::byte *>((v + alignment - 1) & ~(std::uintptr_t(alignment) - 1));
+    }
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+        auto p = align_up(m_ptr, alignment);
+        if (!m_ptr || p + bytes > m_end) {
+            grow(bytes, alignment);
+            p = align_up(m_ptr, alignment);
+        }
+        m_ptr = p + bytes;
+        m_used += bytes;
+        return p;
+    }
+
+    //  monotonic, memory only comes back on reset or release
+    void do_deallocate(void *, std::size_t, std::size_t) override {}
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+    void grow(std::size_t bytes, std::size_t alignment) {
+        const auto need = sizeof(block) + bytes + alignment;
+        const auto size = std::max(m_next_size, need);
+        if (size == m_next_size) m_next_size = std::min(m_next_size * 2, std::max(m_options.max_block, m_next_size));
+
+        auto b = new_block(size);
+        b->prev = m_current;
+        m_current = b;
+        m_capacity += b->size;
+        m_ptr = reinterpret_cast<std::byte *>(b + 1);
+        m_end = reinterpret_cast<std::byte *>(b) + b->size;
+    }
+
+    block *new_block(std::size_t size) {
+        void *p;
+        if (m_options.backing == xml_arena_backing::upstream) {
+            p = m_upstream->allocate(size, alignof(block));
+        } else {
+            const auto huge = m_options.backing == xml_arena_backing::hugepages;
+            const auto step = huge ? std::size_t(2) << 20 : static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            size = (size + step - 1) / step * step;
+            p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+            if (huge) ::madvise(p, size, MADV_HUGEPAGE);
+#endif
+        }
+        auto b = static_cast<block *>(p);
+        b->size = size;
+        return b;
+    }
+
+    void free_block(block *b) noexcept {
+        if (m_options.backing == xml_arena_backing::upstream) m_upstream->deallocate(b, b->size, alignof(block));
+        else ::munmap(b, b->size);
+    }
+
+    xml_arena_options m_options;
+    std::pmr::memory_resource *m_upstream;
+    std::size_t m_next_size;
+
+    std::byte *m_buffer = nullptr;      //  not owned
+    std::size_t m_buffer_size = 0;
+
+    block *m_current = nullptr;         //  the newest block, the chain runs back through prev
+    std::byte *m_ptr = nullptr;         //  next free byte
+    std::byte *m_end = nullptr;
+    std::size_t m_used = 0;
+    std::size_t m_capacity = 0;
+};
+
+///  Arenas made on demand, each with an allocator over it, that live until clear().  Parts of a document parsed on
+///  other threads each get one of their own, so no arena is ever shared between threads
+class xml_arena_set {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    explicit xml_arena_set(const xml_arena_options &options = {}) : m_options(options) {}
+
+    xml_arena_set(const xml_arena_set &) = delete;
+
+    xml_arena_set &operator=(const xml_arena_set &) = delete;
+
+    ///  the allocator of a new arena, which stays where it is until clear()
+    const allocator_type &make() { return m_entries.emplace_back(m_options).alloc; }
+
+    ///  give every arena back, nothing allocated from them may be used after
+    void clear() noexcept { m_entries.clear(); }
+
+    [[nodiscard]] std::size_t size() const noexcept { return m_entries.size(); }
+
+private:
+    struct entry {
+        explicit entry(const xml_arena_options &options) : arena(options) {}
+
+        xml_arena_resource arena;
+        allocator_type alloc{&arena};
+    };
+
+    xml_arena_options m_options;
+    std::deque<entry> m_entries;
+};
+
+#endif //PARSER_XML_ARENA_H
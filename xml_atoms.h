@@ -0,0 +1,152 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_ATOMS_H
+#define PARSER_XML_ATOMS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "xml_attr_table.h"
+
+///  An interned name, equal atoms from one table are equal names.  none is no name
+enum class xml_atom : std::uint32_t {
+    none = 0
+};
+
+std::ostream &operator<<(std::ostream &lhs, xml_atom rhs) {
+    if (rhs == xml_atom::none) return lhs << "No Atom";
+    return lhs << "Atom " << static_cast<std::uint32_t>(rhs);
+}
+
+///  Interns element and attribute names.  Every distinct name is stored once and given an xml_atom, the names stay
+///  where they are for as long as the table lives, so nodes can view them instead of copying.
+///
+///  A table is either private to one document, with no locking, or shared between documents parsed on many threads,
+///  where lookups of names already interned take a shared lock and only a new name takes the lock exclusively.  A
+///  private table is cleared with its document, so it only holds the names of one parse.
+template<typename CharT = char>
+class xml_atom_table {
+public:
+    using view_type = std::basic_string_view<CharT>;
+
+    explicit xml_atom_table(bool shared = false) : m_shared(shared) {}
+
+    xml_atom_table(const xml_atom_table &) = delete;
+
+    xml_atom_table &operator=(const xml_atom_table &) = delete;
+
+    ///  the atom of name, added to the table when it is new.  kept, when given, is set to the table's copy of name
+    xml_atom intern(const view_type name, view_type *kept = nullptr) {
+        if (!m_shared) return insert(name, kept);
+        {
+            std::shared_lock lock(m_mutex);
+            const auto i = m_index.find(name, m_names.size(), names());
+            if (i != m_index.npos) {
+                if (kept) *kept = m_names[i];
+                return atom(i);
+            }
+        }
+        std::unique_lock lock(m_mutex);
+        return insert(name, kept);
+    }
+
+    ///  the atom of name, none when it was never interned.  For callers that look names up on every document
+    [[nodiscard]] xml_atom find(const view_type name) const {
+        std::shared_lock<std::shared_mutex> lock;
+        if (m_shared) lock = std::shared_lock(m_mutex);
+        const auto i = m_index.find(name, m_names.size(), names());
+        return i == m_index.npos ? xml_atom::none : atom(i);
+    }
+
+    ///  the name of atom, empty for none
+    [[nodiscard]] view_type name(const xml_atom atom) const {
+        if (atom == xml_atom::none) return view_type();
+        std::shared_lock<std::shared_mutex> lock;
+        if (m_shared) lock = std::shared_lock(m_mutex);
+        return m_names[static_cast<std::uint32_t>(atom) - 1];
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        std::shared_lock<std::shared_mutex> lock;
+        if (m_shared) lock = std::shared_lock(m_mutex);
+        return m_names.size();
+    }
+
+    [[nodiscard]] bool shared() const noexcept { return m_shared; }
+
+    ///  Drop every name, the atoms handed out before and the views of the names are no longer valid.  The index and
+    ///  the largest block of names are kept for the names to come, so a table cleared between documents stops
+    ///  allocating once it has held the most names of any of them
+    void clear() {
+        std::unique_lock<std::shared_mutex> lock;
+        if (m_shared) lock = std::unique_lock(m_mutex);
+        m_index.clear();
+        m_names.clear();
+        if (m_blocks.empty()) return;
+        auto largest = std::max_element(m_blocks.begin(), m_blocks.end(),
+                                        [](const block &l, const block &r) { return l.second < r.second; });
+        std::swap(*largest, m_blocks.front());
+        m_blocks.erase(m_blocks.begin() + 1, m_blocks.end());
+        m_next = m_blocks.front().first.get();
+        m_left = m_blocks.front().second;
+    }
+
+    ///  Start or stop locking.  Only while no other thread is using the table, a parallel parse locks a private table
+    ///  for as long as its parts run
+    void set_shared(bool shared) noexcept { m_shared = shared; }
+
+private:
+    static constexpr std::size_t block_size = 4096;
+
+    using block = std::pair<std::unique_ptr<CharT[]>, std::size_t>;
+
+    static xml_atom atom(const std::size_t i) noexcept { return static_cast<xml_atom>(i + 1); }
+
+    auto names() const noexcept { return [this](std::size_t i) { return m_names[i]; }; }
+
+    //  the caller holds the lock exclusively, when there is one
+    xml_atom insert(const view_type name, view_type *kept) {
+        auto i = m_index.find(name, m_names.size(), names());
+        if (i == m_index.npos) {
+            i = m_names.size();
+            m_names.push_back(store(name));
+            m_index.added(m_names.size(), names());
+        }
+        if (kept) *kept = m_names[i];
+        return atom(i);
+    }
+
+    ///  copy name where it will not move
+    view_type store(const view_type name) {
+        if (name.length() > m_left) {
+            const auto size = std::max(block_size, name.length());
+            m_blocks.emplace_back(std::make_unique<CharT[]>(size), size);
+            m_next = m_blocks.back().first.get();
+            m_left = size;
+        }
+        std::char_traits<CharT>::copy(m_next, name.data(), name.length());
+        const view_type out(m_next, name.length());
+        m_next += name.length();
+        m_left -= name.length();
+        return out;
+    }
+
+    xml_attr_table<CharT> m_index;                      //  of the names, by position
+    std::vector<view_type> m_names;                     //  atom - 1 to name
+    std::vector<block> m_blocks;                        //  the names, and the size of each block
+    CharT *m_next = nullptr;
+    std::size_t m_left = 0;
+    mutable std::shared_mutex m_mutex;
+    bool m_shared;
+};
+
+#endif //PARSER_XML_ATOMS_H
@@ -0,0 +1,80 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_ATTR_TABLE_H
+#define PARSER_XML_ATTR_TABLE_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+///  Finds a name in a list that is only appended to, the attributes of a tag or the names of an xml_atom_table.  The
+///  list is searched front to back while it is at most linear_max long, past that through an open addressed table of
+///  positions hashed by name, which is built when the list outgrows linear_max.  names(i) gives the name at position
+///  i.  clear() keeps the table's memory, so a list filled again to the same length allocates nothing.
+template<typename CharT, typename Alloc = std::allocator<std::uint32_t>>
+class xml_attr_table {
+public:
+    using view_type = std::basic_string_view<CharT>;
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    ///  most elements have a handful of attributes, a scan over them beats hashing the name
+    static constexpr std::size_t linear_max = 8;
+
+    xml_attr_table() = default;
+
+    explicit xml_attr_table(const Alloc &alloc) : m_slots(alloc) {}
+
+    ///  position of name among the first n, or npos
+    template<typename Names>
+    std::size_t find(const view_type name, const std::size_t n, const Names &names) const {
+        if (n <= linear_max) {
+            for (std::size_t i = 0; i < n; ++i) if (names(i) == name) return i;
+            return npos;
+        }
+        const auto mask = m_slots.size() - 1;
+        for (auto slot = hash(name) & mask;; slot = (slot + 1) & mask) {
+            const auto pos = m_slots[slot];
+            if (pos == 0) return npos;
+            if (names(pos - 1) == name) return pos - 1;
+        }
+    }
+
+    ///  position n - 1 was just appended
+    template<typename Names>
+    void added(const std::size_t n, const Names &names) {
+        if (n <= linear_max) return;
+
+        //  kept at most half full
+        if (n * 2 > m_slots.size()) {
+            std::size_t size = 16;
+            while (size < n * 4) size *= 2;
+            m_slots.assign(size, 0);
+            for (std::size_t i = 0; i < n; ++i) place(names(i), i);
+        } else {
+            place(names(n - 1), n - 1);
+        }
+    }
+
+    void clear() noexcept { m_slots.clear(); }
+
+    void release() noexcept { std::vector<std::uint32_t, Alloc>(m_slots.get_allocator()).swap(m_slots); }
+
+private:
+    static std::size_t hash(const view_type name) noexcept { return std::hash<view_type>()(name); }
+
+    void place(const view_type name, const std::size_t pos) {
+        const auto mask = m_slots.size() - 1;
+        auto slot = hash(name) & mask;
+        while (m_slots[slot] != 0) slot = (slot + 1) & mask;
+        m_slots[slot] = static_cast<std::uint32_t>(pos + 1);
+    }
+
+    std::vector<std::uint32_t, Alloc> m_slots;  //  position + 1, 0 is empty
+};
+
+#endif //PARSER_XML_ATTR_TABLE_H
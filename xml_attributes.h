@@ -0,0 +1,107 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_ATTRIBUTES_H
+#define PARSER_XML_ATTRIBUTES_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "xml_attr_table.h"
+
+//  xml_attributes holds xml_strings, jacob_parser.h includes it after xml_string.h and xml_atoms.h
+
+///  The attributes of an xml_node, name and value pairs in source order in one array, with an xml_attr_table to find
+///  them by name.  The atoms of the names are kept alongside, so a caller holding an atom finds an attribute without
+///  comparing any text.
+template<typename CharT>
+class xml_attributes {
+public:
+    using view_type = std::basic_string_view<CharT>;
+    using value_type = std::pair<xml_string<CharT>, xml_string<CharT>>;
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+    using container = std::pmr::vector<value_type>;
+    using iterator = typename container::iterator;
+    using const_iterator = typename container::const_iterator;
+
+    xml_attributes() = default;
+
+    explicit xml_attributes(const allocator_type &alloc) : m_items(alloc), m_atoms(alloc), m_table(alloc) {}
+
+    ///  append name and value, unless an attribute of that name is already there
+    std::pair<iterator, bool>
+    emplace(xml_string<CharT> &&name, xml_string<CharT> &&value, const xml_atom atom = xml_atom::none) {
+        const auto found = find_pos(name.view());
+        if (found != table_type::npos) return {m_items.begin() + found, false};
+
+        //  the common handful of attributes in one allocation
+        if (m_items.empty()) {
+            m_items.reserve(4);
+            m_atoms.reserve(4);
+        }
+        m_items.emplace_back(std::move(name), std::move(value));
+        m_atoms.push_back(atom);
+        m_table.added(m_items.size(), names());
+        return {m_items.end() - 1, true};
+    }
+
+    std::pair<iterator, bool> emplace(value_type &&item) { return emplace(std::move(item.first), std::move(item.second)); }
+
+    [[nodiscard]] bool contains(const view_type name) const { return find_pos(name) != table_type::npos; }
+
+    [[nodiscard]] const_iterator find(const view_type name) const {
+        const auto pos = find_pos(name);
+        return pos == table_type::npos ? m_items.end() : m_items.begin() + pos;
+    }
+
+    ///  an atom names one attribute at most, so the first match is the only one
+    [[nodiscard]] const_iterator find(const xml_atom atom) const noexcept {
+        if (atom == xml_atom::none) return m_items.end();
+        const auto it = std::find(m_atoms.begin(), m_atoms.end(), atom);
+        return m_items.begin() + (it - m_atoms.begin());
+    }
+
+    [[nodiscard]] xml_atom atom(std::size_t i) const noexcept { return m_atoms[i]; }
+
+    void clear() noexcept {
+        m_items.clear();
+        m_atoms.clear();
+        m_table.clear();
+    }
+
+    ///  clear and give the memory back, before the arena it came from is rewound
+    void release() noexcept {
+        container(m_items.get_allocator()).swap(m_items);
+        std::pmr::vector<xml_atom>(m_atoms.get_allocator()).swap(m_atoms);
+        m_table.release();
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return m_items.size(); }
+
+    [[nodiscard]] bool empty() const noexcept { return m_items.empty(); }
+
+    [[nodiscard]] const_iterator begin() const noexcept { return m_items.begin(); }
+
+    [[nodiscard]] const_iterator end() const noexcept { return m_items.end(); }
+
+    const value_type &operator[](std::size_t i) const noexcept { return m_items[i]; }
+
+private:
+    using table_type = xml_attr_table<CharT, std::pmr::polymorphic_allocator<std::uint32_t>>;
+
+    //  names are never coded, view() does not decode
+    auto names() const noexcept { return [this](std::size_t i) { return m_items[i].first.view(); }; }
+
+    std::size_t find_pos(const view_type name) const { return m_table.find(name, m_items.size(), names()); }
+
+    container m_items;
+    std::pmr::vector<xml_atom> m_atoms;     //  of each name, none when it was not interned
+    table_type m_table;
+};
+
+#endif //PARSER_XML_ATTRIBUTES_H
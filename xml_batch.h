@@ -0,0 +1,132 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_BATCH_H
+#define PARSER_XML_BATCH_H
+
+#include <atomic>
+#include <condition_variable>
+#include <iterator>
+#include <mutex>
+#include <vector>
+#include "jacob_parser.h"
+#include "xml_pool.h"
+#include "xml_thread_pool.h"
+
+struct xml_batch_options {
+    std::size_t batch_size = 16;    //  documents a worker claims at a time, larger batches contend less on the counter
+    bool ordered = false;           //  hand the documents over in input order, else as each is parsed
+};
+
+///  Parses many small documents at once on an xml_thread_pool.  Workers claim the inputs batch_size at a time and
+///  parse each into a document of their own, warm from an xml_document_pool, so a steady stream of documents is parsed
+///  without allocating.
+///
+///  The documents are reused, so each is handed to on_document(index, document) as soon as it is parsed and is gone
+///  once on_document returns.  Unordered, on_document is called on many threads at once.  Ordered, the calls come one
+///  at a time in input order, a worker that finishes early waits its turn.  Either way on_document must not throw.
+template<typename CharT = char, std::size_t Buff = 4096, typename Trace = xml_null_trace>
+class xml_batch_parser {
+public:
+    using document_type = xml_document<CharT, Buff, Trace>;
+    using view_type = std::basic_string_view<CharT>;
+    using result_type = result<std::size_t, xml_error>;
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    ///  the documents are made with arena and parse in mode
+    explicit xml_batch_parser(xml_thread_pool &pool, const xml_batch_options &options = {},
+                              const xml_arena_options &arena = {}, parse_mode mode = parse_mode::copy) :
+            m_pool(pool), m_options(options), m_documents(pool.size() + 1, arena, mode) {}
+
+    xml_batch_parser(const xml_batch_parser &) = delete;
+
+    xml_batch_parser &operator=(const xml_batch_parser &) = delete;
+
+    ///  Parse the n documents at inputs.  The result of each is the length parsed or npos with an error, in input order
+    template<typename F>
+    std::vector<result_type> parse(const view_type *inputs, std::size_t n, F &&on_document) {
+        std::vector<result_type> out(n, result_type(npos, xml_error::unexpected));
+        if (n == 0) return out;
+
+        const auto batch = m_options.batch_size ? m_options.batch_size : 1;
+        const auto batches = (n + batch - 1) / batch;
+        std::atomic<std::size_t> next_batch{0};
+        turn order;
+
+        //  Batches are claimed in order, so in ordered mode every document a worker waits on is held by a worker that
+        //  is already running
+        auto work = [&](std::size_t) {
+            auto doc = m_documents.acquire();
+            for (auto b = next_batch.fetch_add(1, std::memory_order_relaxed); b < batches;
+                 b = next_batch.fetch_add(1, std::memory_order_relaxed)) {
+                const auto last = std::min(n, (b + 1) * batch);
+                for (auto i = b * batch; i < last; ++i) {
+                    const auto length = doc->parse(inputs[i]);
+                    out[i] = length == npos ? result_type(npos, xml_error::unexpected)
+                                            : result_type(length, std::error_condition());
+                    if (m_options.ordered) order.wait(i);
+                    on_document(i, static_cast<const document_type &>(*doc));
+                    if (m_options.ordered) order.done(i);
+                }
+            }
+        };
+        m_pool.parallel_for(std::min(batches, m_pool.size() + 1), work);
+        return out;
+    }
+
+    ///  inputs is any contiguous range of view_type, or of something a view_type converts from
+    template<typename Range, typename F>
+    std::vector<result_type> parse(const Range &inputs, F &&on_document) {
+        if constexpr (std::is_convertible_v<decltype(std::data(inputs)), const view_type *>) {
+            return parse(std::data(inputs), std::size(inputs), std::forward<F>(on_document));
+        } else {
+            std::vector<view_type> views(std::begin(inputs), std::end(inputs));
+            return parse(views.data(), views.size(), std::forward<F>(on_document));
+        }
+    }
+
+    ///  only check the documents
+    template<typename Range>
+    std::vector<result_type> parse(const Range &inputs) {
+        return parse(inputs, [](std::size_t, const document_type &) {});
+    }
+
+    [[nodiscard]] const xml_batch_options &options() const noexcept { return m_options; }
+
+    ///  takes effect on the next parse
+    void set_options(const xml_batch_options &options) noexcept { m_options = options; }
+
+    ///  times a worker found every warm document taken and parsed into a new one
+    [[nodiscard]] std::size_t overflow() const noexcept { return m_documents.overflow(); }
+
+private:
+    ///  whose turn it is to hand its document over, in ordered mode
+    class turn {
+    public:
+        void wait(std::size_t i) {
+            std::unique_lock lock(m_mutex);
+            m_cv.wait(lock, [&] { return m_next == i; });
+        }
+
+        void done(std::size_t i) {
+            {
+                std::lock_guard lock(m_mutex);
+                m_next = i + 1;
+            }
+            m_cv.notify_all();
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::size_t m_next = 0;
+    };
+
+    xml_thread_pool &m_pool;
+    xml_batch_options m_options;
+    xml_document_pool<CharT, Buff, Trace> m_documents;
+};
+
+#endif //PARSER_XML_BATCH_H
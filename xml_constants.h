@@ -7,9 +7,12 @@
 
 #include <string_view>
 #include <string>
-#include <functional>
+#include <array>
+#include <cstdint>
+#include <type_traits>
 #include "result.h"
 #include "xml_error_category.h"
+#include "xml_scan.h"
 
 enum class constant {
     CharComment,
@@ -23,7 +26,9 @@ enum class constant {
     CharData,
     digit,
     EncNameStart,
-    EncName
+    EncName,
+    Markup,
+    TagClose
 };
 
 std::ostream & operator<< (std::ostream & lhs, constant rhs){
@@ -52,6 +57,10 @@ std::ostream & operator<< (std::ostream & lhs, constant rhs){
             return lhs << "EncNameStart";
         case constant::EncName:
             return lhs << "EncName";
+        case constant::Markup:
+            return lhs << "Markup";
+        case constant::TagClose:
+            return lhs << "TagClose";
     }
     return lhs;
 }
@@ -181,51 +190,88 @@ constexpr std::basic_string_view<CharT> get_const() {
         if constexpr (std::is_same_v<CharT, char16_t>) return u"<&\'";
         if constexpr (std::is_same_v<CharT, char32_t>) return U"<&\'";
     }
+
+    if constexpr (cnst == constant::Markup) {
+        if constexpr (std::is_same_v<CharT, char>) return "<";
+        if constexpr (std::is_same_v<CharT, wchar_t>) return L"<";
+        if constexpr (std::is_same_v<CharT, char16_t>) return u"<";
+        if constexpr (std::is_same_v<CharT, char32_t>) return U"<";
+    }
+
+    if constexpr (cnst == constant::TagClose) {
+        if constexpr (std::is_same_v<CharT, char>) return ">\"\'";
+        if constexpr (std::is_same_v<CharT, wchar_t>) return L">\"\'";
+        if constexpr (std::is_same_v<CharT, char16_t>) return u">\"\'";
+        if constexpr (std::is_same_v<CharT, char32_t>) return U">\"\'";
+    }
 }
 
-template<typename CharT, bool FO, constant cnst>
-struct xml_constant {
-    using view_type = std::basic_string_view<CharT>;
-    static constexpr std::basic_string_view<CharT> s = get_const<CharT, cnst>();
+///  Every constant set classified at once.  Entry c has bit n set when c is a member of get_const<CharT, constant(n)>,
+///  so a membership test is one load and a mask.  Wide code units go through a two level table; the sets are all ascii
+///  so every page but the first shares one empty leaf.
+template<typename CharT>
+struct xml_char_table {
+    using class_type = std::uint16_t;
+    using unsigned_type = std::make_unsigned_t<CharT>;
 
-    static constexpr bool contains(const CharT c) noexcept {
-        if constexpr (FO) {
-            if (s.find(c) != std::basic_string_view<CharT>::npos) return false;
+    static constexpr std::size_t page_bits = 8;
+    static constexpr std::size_t page_size = std::size_t(1) << page_bits;
+
+    ///  pages needed to cover every code unit up to U+10FFFF
+    static constexpr std::size_t page_count = sizeof(CharT) == 1 ? 1 : sizeof(CharT) == 2 ? 0x100 : 0x1100;
+
+    static constexpr class_type bit(const constant c) noexcept {
+        return static_cast<class_type>(1u << static_cast<unsigned>(c));
+    }
+
+    static constexpr class_type classify(const CharT c) noexcept {
+        const auto u = static_cast<unsigned_type>(c);
+        if constexpr (sizeof(CharT) == 1) {
+            return leaves[0][u];
         } else {
-            if (s.find(c) == std::basic_string_view<CharT>::npos) return false;
+            if ((u >> page_bits) >= page_count) return 0;
+            return leaves[pages[u >> page_bits]][u & (page_size - 1)];
         }
-        return true;
     }
 
-    static result<std::size_t, xml_error> skip(const std::basic_string_view<CharT> sv,
-                                               std::function<action(const view_type)> p = [](
-                                                       const view_type) { return action::return_; }) {
-        std::size_t out;
+private:
+    using leaf_type = std::array<class_type, page_size>;
 
-        if constexpr (FO) {
-            out = sv.find_first_of(s);
-        } else {
-            out = sv.find_first_not_of(s);
+    template<constant cnst>
+    static constexpr void add(leaf_type &leaf) noexcept {
+        constexpr auto s = get_const<CharT, cnst>();
+        for (std::size_t i = 0; i < s.length(); ++i) {
+            leaf[static_cast<unsigned_type>(s[i])] |= bit(cnst);
         }
+    }
 
-        if (out == std::basic_string_view<CharT>::npos) {
-            return {std::basic_string_view<CharT>::npos, xml_error::unexpected};
-        }
+    static constexpr std::array<leaf_type, 2> make_leaves() noexcept {
+        std::array<leaf_type, 2> out{};
+        add<constant::CharComment>(out[0]);
+        add<constant::NameStartChar>(out[0]);
+        add<constant::NameChar>(out[0]);
+        add<constant::S>(out[0]);
+        add<constant::AttValue_quot>(out[0]);
+        add<constant::AttValue_apos>(out[0]);
+        add<constant::CharPI>(out[0]);
+        add<constant::CharCDATA>(out[0]);
+        add<constant::CharData>(out[0]);
+        add<constant::digit>(out[0]);
+        add<constant::EncNameStart>(out[0]);
+        add<constant::EncName>(out[0]);
+        add<constant::Markup>(out[0]);
+        add<constant::TagClose>(out[0]);
+        return out;
+    }
 
-        auto t = p(&sv[out]);
-        switch (t) {
-            case action::error_:
-                return {std::basic_string_view<CharT>::npos, xml_error::unexpected};
-            case action::continue_:
-                ++out;
-                out += skip(sv.substr(out), p);
-                [[fallthrough]];
-            case action::return_:
-            default:
-                return {out, std::error_condition()};
-        }
+    static constexpr std::array<std::uint8_t, page_count> make_pages() noexcept {
+        std::array<std::uint8_t, page_count> out{};
+        for (std::size_t i = 1; i < page_count; ++i) out[i] = 1;
+        return out;
     }
 
+    static constexpr std::array<leaf_type, 2> leaves = make_leaves();  //  leaf 0 holds the ascii sets, leaf 1 is empty
+    static constexpr std::array<std::uint8_t, page_count> pages = make_pages();
 };
 
 template<typename CharT, bool INSENS = false>
@@ -244,4 +290,62 @@ bool xml_const_compare(std::basic_string_view<CharT> sv, const char *st) noexcep
     return true;
 }
 
+template<typename CharT, bool FO, constant cnst>
+struct xml_constant {
+    using view_type = std::basic_string_view<CharT>;
+    static constexpr std::basic_string_view<CharT> s = get_const<CharT, cnst>();
+
+    ///  the code units skip() stops on, members of s when FO else everything else
+    static constexpr xml_scan_set stop_set = make_scan_set<CharT>(s, FO);
+
+    static constexpr bool contains(const CharT c) noexcept {
+        const bool member = xml_char_table<CharT>::classify(c) & xml_char_table<CharT>::bit(cnst);
+        return member != FO;
+    }
+
+    ///  the default skip predicate, return at the first code unit found
+    struct first {
+        constexpr action operator()(const view_type) const noexcept { return action::return_; }
+    };
+
+    ///  Skip to the first code unit skip stops on and ask the predicate what to do about it.  The predicate is a
+    ///  template parameter so it inlines, and continue_ resumes the scan in place instead of recursing.
+    template<typename Pred = first>
+    static result<std::size_t, xml_error> skip(const view_type sv, Pred p = Pred()) noexcept {
+        std::size_t out = 0;
+
+        for (;;) {
+            out += xml_scan<CharT>::find(sv.data() + out, sv.length() - out, stop_set);
+            if (out == sv.length()) {
+                return {view_type::npos, xml_error::unexpected};
+            }
+
+            switch (p(sv.substr(out))) {
+                case action::error_:
+                    return {view_type::npos, xml_error::unexpected};
+                case action::continue_:
+                    ++out;
+                    break;
+                case action::return_:
+                default:
+                    return {out, std::error_condition()};
+            }
+        }
+    }
+
+    ///  Index of the first occurrence of the literal seq in sv, npos when there is none.  seq must start with a member
+    ///  of s; the scan hops between members of s and only compares the whole sequence there.
+    static std::size_t find(const view_type sv, const char *seq) noexcept {
+        std::size_t out = 0;
+
+        for (;;) {
+            out += xml_scan<CharT>::find(sv.data() + out, sv.length() - out, stop_set);
+            if (out == sv.length()) return view_type::npos;
+            if (xml_const_compare(sv.substr(out), seq)) return out;
+            ++out;
+        }
+    }
+
+};
+
 #endif //PARSER_XML_CONSTANTS_H
@@ -10,7 +10,8 @@
 enum class xml_error : int {
     no_error = 0,
     unexpected = 1,
-    other_fatal = 2
+    other_fatal = 2,
+    too_deep = 3        //  elements nested past the depth allowed
 };
 
 std::ostream & operator<<(std::ostream &  lhs, xml_error rhs){
@@ -21,6 +22,8 @@ std::ostream & operator<<(std::ostream &  lhs, xml_error rhs){
             return lhs << "Unexpected Char";
         case xml_error::other_fatal:
             return lhs << "Other Fatal Error";
+        case xml_error::too_deep:
+            return lhs << "Nesting Too Deep";
         default:
             return lhs;
     }
@@ -40,6 +43,8 @@ class xml_error_category : public std::error_category {
                 return "Unexpected Character";
             case xml_error::other_fatal:
                 return "fatal error";
+            case xml_error::too_deep:
+                return "elements nested too deep";
             default:
                 break;
         }
@@ -0,0 +1,145 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_FILE_H
+#define PARSER_XML_FILE_H
+
+#include <cerrno>
+#include <cstddef>
+#include <string_view>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+///  how xml_mapped_file maps and advises
+struct xml_map_options {
+    bool sequential = true;     //  MADV_SEQUENTIAL, read ahead aggressively and drop pages behind the parse
+    bool willneed = true;       //  MADV_WILLNEED, start reading the whole file in now
+    bool hugepages = false;     //  MADV_HUGEPAGE, where the file system supports it
+    bool populate = false;      //  MAP_POPULATE, fault every page in before returning
+    bool writable = false;      //  copy on write, for parse_mode::in_situ.  The file itself is never written
+};
+
+///  A file mapped into memory.  The parser reads past the end of its input until it meets a '\0', so the mapping is
+///  always followed by at least one page of zeros, even when the file fills its last page.
+class xml_mapped_file {
+public:
+    xml_mapped_file() = default;
+
+    explicit xml_mapped_file(const char *path, const xml_map_options &options = {}) { open(path, options); }
+
+    xml_mapped_file(const xml_mapped_file &) = delete;
+
+    xml_mapped_file &operator=(const xml_mapped_file &) = delete;
+
+    xml_mapped_file(xml_mapped_file &&other) noexcept : m_base(other.m_base), m_length(other.m_length),
+                                                        m_size(other.m_size), m_error(other.m_error) {
+        other.m_base = nullptr;
+        other.m_length = other.m_size = 0;
+    }
+
+    xml_mapped_file &operator=(xml_mapped_file &&other) noexcept {
+        if (this != &other) {
+            close();
+            m_base = other.m_base;
+            m_length = other.m_length;
+            m_size = other.m_size;
+            m_error = other.m_error;
+            other.m_base = nullptr;
+            other.m_length = other.m_size = 0;
+        }
+        return *this;
+    }
+
+    ~xml_mapped_file() { close(); }
+
+    ///  map the file at path, replacing any file already mapped
+    std::error_code open(const char *path, const xml_map_options &options = {}) {
+        close();
+
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return fail();
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            auto out = fail();
+            ::close(fd);
+            return out;
+        }
+
+        //  reserve the file rounded up to whole pages plus one page of zeros, then map the file over the front of it
+        const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        const auto size = static_cast<std::size_t>(st.st_size);
+        const std::size_t length = (size + page - 1) / page * page + page;
+
+        void *base = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            auto out = fail();
+            ::close(fd);
+            return out;
+        }
+
+        if (size) {
+            const int prot = options.writable ? PROT_READ | PROT_WRITE : PROT_READ;
+            const int flags = MAP_PRIVATE | MAP_FIXED | (options.populate ? MAP_POPULATE : 0);
+            if (::mmap(base, size, prot, flags, fd, 0) == MAP_FAILED) {
+                auto out = fail();
+                ::munmap(base, length);
+                ::close(fd);
+                return out;
+            }
+        }
+        ::close(fd);
+
+        m_base = base;
+        m_length = length;
+        m_size = size;
+
+        //  advice is only a hint, a kernel that does not take it still maps the file
+        if (size) {
+            if (options.sequential) ::madvise(base, size, MADV_SEQUENTIAL);
+            if (options.willneed) ::madvise(base, size, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+            if (options.hugepages) ::madvise(base, size, MADV_HUGEPAGE);
+#endif
+        }
+        return m_error = std::error_code();
+    }
+
+    void close() noexcept {
+        if (m_base) ::munmap(m_base, m_length);
+        m_base = nullptr;
+        m_length = m_size = 0;
+    }
+
+    [[nodiscard]] bool is_open() const noexcept { return m_base != nullptr; }
+
+    ///  why the last open failed
+    [[nodiscard]] std::error_code error() const noexcept { return m_error; }
+
+    ///  size of the file in bytes
+    [[nodiscard]] std::size_t size() const noexcept { return m_size; }
+
+    ///  the file as code units of CharT, a trailing partial code unit is left out
+    template<typename CharT>
+    [[nodiscard]] std::basic_string_view<CharT> view() const noexcept {
+        return {data<CharT>(), m_size / sizeof(CharT)};
+    }
+
+    ///  only writable when the file was opened writable
+    template<typename CharT>
+    [[nodiscard]] CharT *data() const noexcept { return static_cast<CharT *>(m_base); }
+
+private:
+    std::error_code fail() { return m_error = std::error_code(errno, std::system_category()); }
+
+    void *m_base = nullptr;
+    std::size_t m_length = 0;   //  mapped, with the zero page
+    std::size_t m_size = 0;     //  of the file
+    std::error_code m_error;
+};
+
+#endif //PARSER_XML_FILE_H
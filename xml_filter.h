@@ -0,0 +1,234 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_FILTER_H
+#define PARSER_XML_FILTER_H
+
+#include <cstdint>
+#include <vector>
+#include "jacob_parser.h"
+#include "xml_path.h"
+#include "xml_sax.h"
+
+///  Pulls the subtrees a set of xml_paths select out of a document without building the rest of it.  The document is
+///  walked tag by tag, every open element remembering the steps its children may match, as xml_path::select does over
+///  a tree.  Only the tags on the way to a match are looked at, and only those a predicate needs are parsed with their
+///  attributes.  Anything no path can reach below is passed over by grammar::skip_content, which counts tag depth
+///  stepping over quoted values, comments, CDATA sections and PIs whole, with no names kept and nothing decoded.
+///
+///  An element a path selects is parsed whole into an xml_node and handed to on_match(path, node), path being its
+///  index in paths().  The node is built in an arena of the filter's, rewound after each match, so memory only grows
+///  with the largest subtree selected and the open elements above it.  A match inside a selected subtree is part of
+///  it and is not handed over again.  The node and the views in it are valid for the duration of the call.
+///
+///  Text and the regions passed over are not validated, a document the full parse rejects may still be filtered.
+template<typename CharT = char, typename Trace = xml_null_trace>
+class xml_subtree_filter {
+    using grammar = xml_traits<CharT, Trace>;
+    using path_type = xml_path<CharT>;
+
+public:
+    using view_type = std::basic_string_view<CharT>;
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    static constexpr std::size_t npos = grammar::npos;
+
+    ///  steps of all the paths together
+    static constexpr std::size_t max_steps = 64;
+
+    explicit xml_subtree_filter(parse_mode mode = parse_mode::copy, const xml_arena_options &arena = {}) :
+            m_arena(arena), m_mode(mode) {}
+
+    ///  paths that do not fit are left out, see add()
+    explicit xml_subtree_filter(const std::vector<path_type> &paths, parse_mode mode = parse_mode::copy,
+                                const xml_arena_options &arena = {}) : xml_subtree_filter(mode, arena) {
+        for (const auto &p : paths) add(p);
+    }
+
+    xml_subtree_filter(const xml_subtree_filter &) = delete;
+
+    xml_subtree_filter &operator=(const xml_subtree_filter &) = delete;
+
+    ///  false when path did not compile or the paths would have more than max_steps between them
+    bool add(const path_type &path) {
+        if (!path.valid() || m_steps.size() + path.m_steps.size() > max_steps) return false;
+        const auto index = m_paths.size();
+        m_paths.push_back(path);
+        m_initial |= std::uint64_t(1) << m_steps.size();
+        for (std::size_t i = 0; i < path.m_steps.size(); ++i) {
+            m_steps.push_back({index, i, m_counters_per_frame, i + 1 == path.m_steps.size(),
+                               path.tests_attributes(path.m_steps[i])});
+        }
+        m_counters_per_frame += path.m_counters;
+        return true;
+    }
+
+    [[nodiscard]] const std::vector<path_type> &paths() const noexcept { return m_paths; }
+
+    void clear() noexcept {
+        m_paths.clear();
+        m_steps.clear();
+        m_initial = 0;
+        m_counters_per_frame = 0;
+    }
+
+    ///  same return as xml_document::parse, the length parsed or npos on error.  Matches found before an error have
+    ///  been handed over
+    template<typename F>
+    std::size_t parse(const view_type sv, F &&on_match) {
+        m_frames.clear();
+        m_counters.assign(m_counters_per_frame, 0);
+        m_frames.push_back({view_type(), m_initial, 0});
+
+        std::size_t pos = grammar::BOM(sv);
+        for (;;) {
+            if (m_frames.size() == 1) {
+                //  prolog, and misc after the root, only markup and white space
+                pos += grammar::S(sv.substr(pos));
+                if (pos >= sv.length()) return sv.length();
+                if (sv[pos] != CharT('<') || sv[pos + 1] == CharT('/')) return npos;
+            } else {
+                //  text is passed over unread
+                auto t_out = grammar::Markup_::skip(sv.substr(pos));
+                if (t_out) return npos;
+                pos += t_out;
+                if (sv[pos + 1] == CharT('/')) {
+                    const auto &top = m_frames.back();
+                    t_out = grammar::Etag(top.name, sv.substr(pos));
+                    if (t_out) return npos;
+                    pos += t_out;
+                    m_counters.resize(top.counters);
+                    m_frames.pop_back();
+                    continue;
+                }
+            }
+
+            const auto markup = sv.substr(pos);
+            auto t_out = markup[1] == CharT('?') || markup[1] == CharT('!')
+                         ? grammar::skip_markup(markup) : element(markup, on_match);
+            if (t_out) return npos;
+            pos += t_out;
+        }
+    }
+
+    ///  filter the file at path straight from a read only mapping of it, npos when it can not be mapped
+    template<typename F>
+    std::size_t parse_file(const char *path, F &&on_match, const xml_map_options &options = {}) {
+        xml_mapped_file file;
+        if (file.open(path, options)) return npos;
+        return parse(file.view<CharT>(), std::forward<F>(on_match));
+    }
+
+private:
+    using xml_result = result<std::size_t, xml_error>;
+
+    ///  a step of one of the paths, the steps of a path are consecutive
+    struct step_ref {
+        std::size_t path;
+        std::size_t step;           //  within the path
+        std::size_t counters;       //  where the path's position counters start in a frame's
+        bool last;                  //  selects
+        bool attributes;            //  has predicates on attributes, the tag must be parsed to match it
+    };
+
+    ///  an element on the way to a match
+    struct frame {
+        view_type name;             //  in the source
+        std::uint64_t states;       //  the steps its children may match
+        std::size_t counters;       //  where its position counters start in m_counters
+    };
+
+    ///  the element at the front of sv: its length, as selected and parsed, opened, or passed over
+    template<typename F>
+    xml_result element(const view_type sv, F &&on_match) {
+        const auto start = 1 + grammar::S(sv.substr(1));
+        auto t_name = grammar::Name(sv.substr(start));
+        if (t_name) return {npos, xml_error::unexpected};
+        const auto name = sv.substr(start, t_name);
+
+        const auto states = m_frames.back().states;
+        std::uint64_t next = 0, candidates = 0;
+        bool attributes = false;
+        for (auto s = states; s; s &= s - 1) {
+            const auto i = static_cast<std::size_t>(__builtin_ctzll(s));
+            const auto &ref = m_steps[i];
+            const auto &st = m_paths[ref.path].m_steps[ref.step];
+            if (st.descendant) next |= std::uint64_t(1) << i;
+            if (!st.name.empty() && view_type(st.name) != name) continue;
+            candidates |= std::uint64_t(1) << i;
+            attributes |= ref.attributes;
+        }
+
+        //  the tag itself, parsed when a predicate needs its attributes
+        std::size_t tag = 0;
+        bool empty = false;
+        m_tag.clear();
+        if (attributes) {
+            auto out = grammar::Stag_Emptytag(&m_tag, sv);
+            if (out.second) return {npos, xml_error::unexpected};
+            m_tag.decode();
+            tag = out.second;
+            empty = out.first;
+        } else {
+            m_tag.assign_name(name);
+        }
+
+        m_selected.clear();
+        const auto counters = m_counters.data() + m_frames.back().counters;
+        for (auto s = candidates; s; s &= s - 1) {
+            const auto i = static_cast<std::size_t>(__builtin_ctzll(s));
+            const auto &ref = m_steps[i];
+            const auto &path = m_paths[ref.path];
+            if (!path.matches(path.m_steps[ref.step], m_tag, counters + ref.counters)) continue;
+            if (ref.last) m_selected.push_back(ref.path);
+            else next |= std::uint64_t(1) << (i + 1);
+        }
+
+        if (!m_selected.empty()) {
+            xml_result t_out;
+            {
+                xml_node<CharT> node(node_type::element, m_alloc, m_mode);
+                t_out = grammar::Element(&node, sv);
+                if (!t_out) for (const auto p : m_selected) on_match(p, static_cast<const xml_node<CharT> &>(node));
+            }
+            m_arena.reset();
+            return t_out;
+        }
+
+        if (!attributes) {
+            auto t_out = grammar::skip_tag(sv);
+            if (t_out) return {npos, xml_error::unexpected};
+            tag = t_out;
+            empty = sv[tag - 2] == CharT('/');
+        }
+        if (empty) return {tag, std::error_condition()};
+
+        //  no path goes further down, fast forward past the end tag
+        if (!next) {
+            auto t_out = grammar::skip_content(sv.substr(tag));
+            if (t_out) return {npos, xml_error::unexpected};
+            return {tag + t_out, std::error_condition()};
+        }
+
+        m_frames.push_back({name, next, m_counters.size()});
+        m_counters.resize(m_counters.size() + m_counters_per_frame, 0);
+        return {tag, std::error_condition()};
+    }
+
+    std::vector<path_type> m_paths;
+    std::vector<step_ref> m_steps;
+    std::uint64_t m_initial = 0;            //  the first step of every path
+    std::size_t m_counters_per_frame = 0;
+
+    std::vector<frame> m_frames;
+    std::vector<std::uint32_t> m_counters;
+    std::vector<std::size_t> m_selected;    //  paths the current element is selected by
+    xml_tag_buffer<CharT> m_tag;
+
+    xml_arena_resource m_arena;
+    allocator_type m_alloc{&m_arena};       //  the selected nodes keep a reference to it
+    parse_mode m_mode;
+};
+
+#endif //PARSER_XML_FILTER_H
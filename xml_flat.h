@@ -0,0 +1,498 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_FLAT_H
+#define PARSER_XML_FLAT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "jacob_parser.h"
+#include "xml_sax.h"
+
+///  Append only storage in fixed size chunks taken from a memory resource.  Elements never move once added, and an
+///  index finds its element with a shift and a mask.
+template<typename T, std::size_t ChunkBits = 12>
+class xml_chunked_array {
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+                  "xml_chunked_array holds plain records");
+
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    static constexpr std::size_t chunk_size = std::size_t(1) << ChunkBits;
+
+    explicit xml_chunked_array(const allocator_type &alloc) : m_alloc(alloc), m_chunks(alloc) {}
+
+    xml_chunked_array(const xml_chunked_array &) = delete;
+
+    xml_chunked_array &operator=(const xml_chunked_array &) = delete;
+
+    ~xml_chunked_array() { clear(); }
+
+    std::size_t push_back(const T &value) {
+        if ((m_size & (chunk_size - 1)) == 0 && (m_size >> ChunkBits) == m_chunks.size()) {
+            m_chunks.push_back(static_cast<T *>(m_alloc.resource()->allocate(sizeof(T) * chunk_size, alignof(T))));
+        }
+        m_chunks[m_size >> ChunkBits][m_size & (chunk_size - 1)] = value;
+        return m_size++;
+    }
+
+    T &operator[](std::size_t i) noexcept { return m_chunks[i >> ChunkBits][i & (chunk_size - 1)]; }
+
+    const T &operator[](std::size_t i) const noexcept { return m_chunks[i >> ChunkBits][i & (chunk_size - 1)]; }
+
+    [[nodiscard]] std::size_t size() const noexcept { return m_size; }
+
+    void clear() noexcept {
+        for (auto chunk : m_chunks) m_alloc.resource()->deallocate(chunk, sizeof(T) * chunk_size, alignof(T));
+        std::pmr::vector<T *>(m_alloc).swap(m_chunks);
+        m_size = 0;
+    }
+
+private:
+    allocator_type m_alloc;
+    std::pmr::vector<T *> m_chunks;
+    std::size_t m_size = 0;
+};
+
+///  A document held as flat records instead of a tree of xml_nodes.  Every node lives in one xml_chunked_array and
+///  links to its parent, first child and next sibling by 32 bit index, every attribute in another.  Names and text
+///  view the source the way parse_mode::view does, only text with references in it is decoded and copied, into a pool
+///  of text blocks.  It is built through xml_sax_parser.
+///
+///  Node 0 is the document, the prolog, root element and trailing misc are its children in source order.
+template<typename CharT = char, std::size_t Buff = 4096, typename Trace = xml_null_trace>
+class xml_flat_document {
+    using view_type = std::basic_string_view<CharT>;
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+public:
+    using index_type = std::uint32_t;
+
+    ///  no node, the end of a sibling chain
+    static constexpr index_type null_index = std::numeric_limits<index_type>::max();
+
+    ///  one node, 48 bytes on a 64 bit target
+    struct record {
+        const CharT *name;
+        const CharT *value;
+        std::uint32_t name_len;
+        std::uint32_t value_len;
+        index_type parent;
+        index_type first_child;
+        index_type next_sibling;
+        index_type first_attr;
+        std::uint32_t attr_count;
+        node_type type;
+    };
+
+    struct attribute_record {
+        const CharT *name;
+        const CharT *value;
+        std::uint32_t name_len;
+        std::uint32_t value_len;
+    };
+
+    class node;
+
+    ///  an attribute of a node
+    class attribute {
+    public:
+        [[nodiscard]] view_type name() const noexcept { return {m_rec->name, m_rec->name_len}; }
+
+        [[nodiscard]] view_type value() const noexcept { return {m_rec->value, m_rec->value_len}; }
+
+    private:
+        friend class xml_flat_document;
+
+        explicit attribute(const attribute_record *rec) noexcept : m_rec(rec) {}
+
+        const attribute_record *m_rec;
+    };
+
+    ///  the attributes of a node in source order
+    class attribute_range {
+    public:
+        class iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = attribute;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = attribute;
+
+            attribute operator*() const noexcept { return attribute(&m_doc->m_attrs[m_index]); }
+
+            iterator &operator++() noexcept {
+                ++m_index;
+                return *this;
+            }
+
+            iterator operator++(int) noexcept {
+                auto out = *this;
+                ++m_index;
+                return out;
+            }
+
+            friend bool operator==(const iterator &lhs, const iterator &rhs) { return lhs.m_index == rhs.m_index; }
+
+            friend bool operator!=(const iterator &lhs, const iterator &rhs) { return lhs.m_index != rhs.m_index; }
+
+        private:
+            friend class attribute_range;
+
+            iterator(const xml_flat_document *doc, index_type index) noexcept : m_doc(doc), m_index(index) {}
+
+            const xml_flat_document *m_doc;
+            index_type m_index;
+        };
+
+        [[nodiscard]] iterator begin() const noexcept { return {m_doc, m_first}; }
+
+        [[nodiscard]] iterator end() const noexcept { return {m_doc, m_first + m_count}; }
+
+        [[nodiscard]] std::size_t size() const noexcept { return m_count; }
+
+        [[nodiscard]] bool empty() const noexcept { return m_count == 0; }
+
+    private:
+        friend class node;
+
+        attribute_range(const xml_flat_document *doc, index_type first, std::uint32_t count) noexcept :
+                m_doc(doc), m_first(first), m_count(count) {}
+
+        const xml_flat_document *m_doc;
+        index_type m_first;
+        std::uint32_t m_count;
+    };
+
+    class child_range;
+
+    ///  A handle on one node, two words, cheap to copy.  A default or null handle is false
+    class node {
+    public:
+        node() = default;
+
+        explicit operator bool() const noexcept { return m_doc && m_index != null_index; }
+
+        [[nodiscard]] index_type index() const noexcept { return m_index; }
+
+        [[nodiscard]] node_type type() const noexcept { return rec().type; }
+
+        [[nodiscard]] view_type name() const noexcept { return {rec().name, rec().name_len}; }
+
+        [[nodiscard]] view_type value() const noexcept { return {rec().value, rec().value_len}; }
+
+        [[nodiscard]] node parent() const noexcept { return {m_doc, rec().parent}; }
+
+        [[nodiscard]] node first_child() const noexcept { return {m_doc, rec().first_child}; }
+
+        [[nodiscard]] node next_sibling() const noexcept { return {m_doc, rec().next_sibling}; }
+
+        [[nodiscard]] child_range children() const noexcept { return child_range(first_child()); }
+
+        [[nodiscard]] attribute_range attributes() const noexcept {
+            return {m_doc, rec().first_attr, rec().attr_count};
+        }
+
+        friend bool operator==(const node &lhs, const node &rhs) { return lhs.m_index == rhs.m_index; }
+
+        friend bool operator!=(const node &lhs, const node &rhs) { return lhs.m_index != rhs.m_index; }
+
+    private:
+        friend class xml_flat_document;
+
+        node(const xml_flat_document *doc, index_type index) noexcept : m_doc(doc), m_index(index) {}
+
+        const record &rec() const noexcept { return m_doc->m_nodes[m_index]; }
+
+        const xml_flat_document *m_doc = nullptr;
+        index_type m_index = null_index;
+    };
+
+    ///  the children of a node, walked along the sibling links
+    class child_range {
+    public:
+        class iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = node;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = node;
+
+            node operator*() const noexcept { return m_node; }
+
+            iterator &operator++() noexcept {
+                m_node = m_node.next_sibling();
+                return *this;
+            }
+
+            iterator operator++(int) noexcept {
+                auto out = *this;
+                m_node = m_node.next_sibling();
+                return out;
+            }
+
+            friend bool operator==(const iterator &lhs, const iterator &rhs) { return lhs.m_node == rhs.m_node; }
+
+            friend bool operator!=(const iterator &lhs, const iterator &rhs) { return lhs.m_node != rhs.m_node; }
+
+        private:
+            friend class child_range;
+
+            explicit iterator(node n) noexcept : m_node(n) {}
+
+            node m_node;
+        };
+
+        [[nodiscard]] iterator begin() const noexcept { return iterator(m_first); }
+
+        [[nodiscard]] iterator end() const noexcept { return iterator(node()); }
+
+        [[nodiscard]] bool empty() const noexcept { return !m_first; }
+
+    private:
+        friend class node;
+
+        explicit child_range(node first) noexcept : m_first(first) {}
+
+        node m_first;
+    };
+
+    xml_flat_document() : m_memresource(std::make_optional<xml_mem_resource<Buff>>()),
+                          m_alloc(&*m_memresource),
+                          m_nodes(m_alloc), m_attrs(m_alloc), m_blocks(m_alloc) {}
+
+    explicit xml_flat_document(const allocator_type &alloc) : m_memresource(std::nullopt),
+                                                              m_alloc(alloc),
+                                                              m_nodes(m_alloc), m_attrs(m_alloc), m_blocks(m_alloc) {}
+
+    xml_flat_document(const xml_flat_document &) = delete;
+
+    xml_flat_document &operator=(const xml_flat_document &) = delete;
+
+    ~xml_flat_document() { clear(); }
+
+    ///  the nodes view sv, which must outlive them.  Same return as xml_document::parse
+    std::size_t parse(const view_type sv) {
+        clear();
+        m_nodes.push_back({nullptr, nullptr, 0, 0, null_index, null_index, null_index, 0, 0, node_type::document});
+
+        builder b{this, sv};
+        b.m_open.push_back({0, null_index});
+        xml_sax_parser<CharT, builder, Trace> sax(b);
+        auto out = sax.parse(sv);
+        return b.m_overflow ? grammar::npos : out;
+    }
+
+    ///  owner is held for as long as the nodes view sv
+    std::size_t parse(const view_type sv, std::shared_ptr<const void> owner) {
+        auto out = parse(sv);
+        m_source = std::move(owner);
+        return out;
+    }
+
+    ///  the document takes str over so the nodes can keep viewing it
+    std::size_t parse(std::basic_string<CharT> &&str) {
+        auto source = std::make_shared<const std::basic_string<CharT>>(std::move(str));
+        const view_type sv(*source);
+        return parse(sv, std::move(source));
+    }
+
+    ///  parse the file at path from a read only mapping of it, which the nodes keep alive
+    std::size_t parse_file(const char *path, const xml_map_options &options = {}) {
+        auto file = std::make_shared<xml_mapped_file>();
+        if (file->open(path, options)) return grammar::npos;
+        const auto sv = file->view<CharT>();
+        return parse(sv, std::move(file));
+    }
+
+    ///  drop the nodes, rewinding the document's own arena like xml_document::clear
+    void clear() {
+        m_nodes.clear();
+        m_attrs.clear();
+        for (auto &b : m_blocks) m_alloc.resource()->deallocate(b.first, b.second * sizeof(CharT), alignof(CharT));
+        decltype(m_blocks)(m_alloc).swap(m_blocks);
+        m_block_left = 0;
+        m_source.reset();
+        if (m_memresource) m_memresource->reset();
+    }
+
+    ///  the document node, whose children are the top level nodes
+    [[nodiscard]] node document() const noexcept { return {this, m_nodes.size() ? 0 : null_index}; }
+
+    ///  the first element at the top level
+    [[nodiscard]] node root() const noexcept {
+        for (auto n : document().children()) if (n.type() == node_type::element) return n;
+        return node();
+    }
+
+    [[nodiscard]] node at(index_type i) const noexcept { return {this, i}; }
+
+    [[nodiscard]] std::size_t size() const noexcept { return m_nodes.size(); }
+
+    [[nodiscard]] std::size_t attribute_count() const noexcept { return m_attrs.size(); }
+
+    const allocator_type &get_alloc() { return m_alloc; }
+
+private:
+    using grammar = xml_traits<CharT, Trace>;
+
+    static constexpr std::size_t text_block = 16384;
+
+    ///  builds the records from the sax events
+    struct builder : xml_sax_handler<CharT> {
+        using attributes = typename xml_sax_handler<CharT>::attributes;
+
+        struct open_node {
+            index_type index;
+            index_type last_child;
+        };
+
+        xml_flat_document *m_doc;
+        view_type m_src;
+        std::vector<open_node> m_open;
+        view_type m_run;                        //  the text run while it is all in the source
+        std::basic_string<CharT> m_text;        //  the whole run once it is not
+        bool m_overflow = false;
+
+        builder(xml_flat_document *doc, view_type src) : m_doc(doc), m_src(src) {}
+
+        bool in_source(const view_type v) const noexcept {
+            const std::less<const CharT *> less;
+            return !less(v.data(), m_src.data()) && !less(m_src.data() + m_src.length(), v.data() + v.length());
+        }
+
+        //  a view that lives as long as the document
+        view_type keep(const view_type v) { return in_source(v) ? v : m_doc->store(v); }
+
+        index_type add(node_type type, view_type name, view_type value) {
+            if (m_doc->m_nodes.size() >= null_index || name.length() > null_index || value.length() > null_index) {
+                m_overflow = true;
+                return null_index;
+            }
+            auto &parent = m_open.back();
+            const auto index = static_cast<index_type>(m_doc->m_nodes.push_back(
+                    {name.data(), value.data(), static_cast<std::uint32_t>(name.length()),
+                     static_cast<std::uint32_t>(value.length()), parent.index, null_index, null_index,
+                     static_cast<index_type>(m_doc->m_attrs.size()), 0, type}));
+            if (parent.last_child == null_index) m_doc->m_nodes[parent.index].first_child = index;
+            else m_doc->m_nodes[parent.last_child].next_sibling = index;
+            parent.last_child = index;
+            return index;
+        }
+
+        void add_attributes(index_type index, const attributes &attrs) {
+            if (index == null_index) return;
+            for (auto &a : attrs) {
+                const auto value = keep(a.value);
+                m_doc->m_attrs.push_back({a.name.data(), value.data(), static_cast<std::uint32_t>(a.name.length()),
+                                          static_cast<std::uint32_t>(value.length())});
+            }
+            m_doc->m_nodes[index].attr_count = static_cast<std::uint32_t>(attrs.size());
+        }
+
+        //  a text run ends at the next markup
+        void flush() {
+            if (m_run.data() == nullptr && m_text.empty()) return;
+            const view_type text = m_text.empty() ? m_run : m_doc->store(m_text);
+            m_run = view_type();
+            m_text.clear();
+
+            //  like xml_document the element's value is its first text
+            auto &parent = m_doc->m_nodes[m_open.back().index];
+            if (parent.value_len == 0) {
+                parent.value = text.data();
+                parent.value_len = static_cast<std::uint32_t>(text.length());
+            }
+            add(node_type::data, view_type(), text);
+        }
+
+        void xml_declaration(const attributes &attrs) {
+            add_attributes(add(node_type::xmldecl, view_type(), view_type()), attrs);
+        }
+
+        void start_element(view_type name, const attributes &attrs) {
+            flush();
+            const auto index = add(node_type::element, name, view_type());
+            add_attributes(index, attrs);
+            m_open.push_back({index == null_index ? 0 : index, null_index});
+        }
+
+        void end_element(view_type) {
+            flush();
+            m_open.pop_back();
+        }
+
+        //  text is only valid for the call, a decoded reference is in a temporary of the parser's, so only text in
+        //  the source that carries on from the run so far is kept as a view
+        void characters(view_type text) {
+            if (m_text.empty() && in_source(text)) {
+                if (m_run.data() == nullptr) {
+                    m_run = text;
+                    return;
+                }
+                if (m_run.data() + m_run.length() == text.data()) {
+                    m_run = view_type(m_run.data(), m_run.length() + text.length());
+                    return;
+                }
+            }
+            if (m_text.empty()) m_text.assign(m_run);
+            m_text.append(text);
+        }
+
+        void comment(view_type text) {
+            flush();
+            add(node_type::comment, view_type(), text);
+        }
+
+        void pi(view_type target, view_type data) {
+            flush();
+            add(node_type::pi, target, data);
+        }
+
+        void cdata(view_type text) {
+            flush();
+            add(node_type::cdata, view_type(), text);
+        }
+    };
+
+    ///  copy v into the text pool
+    view_type store(const view_type v) {
+        if (v.empty()) return view_type();
+        if (v.length() > m_block_left) {
+            const std::size_t size = std::max(text_block, v.length());
+            m_block = static_cast<CharT *>(m_alloc.resource()->allocate(size * sizeof(CharT), alignof(CharT)));
+            m_blocks.push_back({m_block, size});
+            m_block_left = size;
+        }
+        std::char_traits<CharT>::copy(m_block, v.data(), v.length());
+        const view_type out(m_block, v.length());
+        m_block += v.length();
+        m_block_left -= v.length();
+        return out;
+    }
+
+    std::optional<xml_mem_resource<Buff>> m_memresource;
+    allocator_type m_alloc;
+    xml_chunked_array<record> m_nodes;
+    xml_chunked_array<attribute_record> m_attrs;
+    std::pmr::vector<std::pair<CharT *, std::size_t>> m_blocks;    //  the text pool
+    CharT *m_block = nullptr;
+    std::size_t m_block_left = 0;
+    std::shared_ptr<const void> m_source;   //  keeps the source alive
+};
+
+#endif //PARSER_XML_FLAT_H
@@ -0,0 +1,315 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_INDEX_H
+#define PARSER_XML_INDEX_H
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "xml_constants.h"
+#include "xml_scan.h"
+
+//  Structural indexing.  Stage one classifies a document 64 code units at a time into bit masks of the characters
+//  that can start or end markup, then resolves them block by block into the offsets where every comment, PI, CDATA
+//  section and tag starts and ends.  Stage two, xml_traits::Document with an index, walks the offsets and runs the
+//  productions on the markup only, the text between them is taken as it is unless the index saw a '&' or ']' in it.
+
+namespace xml_index_detail {
+
+    ///  one bit per code unit of a block, bit i for the i-th
+    struct masks {
+        std::uint64_t lt = 0;
+        std::uint64_t gt = 0;
+        std::uint64_t quot = 0;
+        std::uint64_t apos = 0;
+        std::uint64_t amp = 0;
+        std::uint64_t rsqb = 0;
+    };
+
+    template<typename CharT>
+    masks scalar(const CharT *p) noexcept {
+        masks m;
+        for (unsigned i = 0; i < 64; ++i) {
+            const auto bit = std::uint64_t(1) << i;
+            switch (p[i]) {
+                case CharT('<'):
+                    m.lt |= bit;
+                    break;
+                case CharT('>'):
+                    m.gt |= bit;
+                    break;
+                case CharT('"'):
+                    m.quot |= bit;
+                    break;
+                case CharT('\''):
+                    m.apos |= bit;
+                    break;
+                case CharT('&'):
+                    m.amp |= bit;
+                    break;
+                case CharT(']'):
+                    m.rsqb |= bit;
+                    break;
+                default:
+                    break;
+            }
+        }
+        return m;
+    }
+
+#ifdef XML_PARSER_SIMD_X86
+
+    //  the loads narrow wider code units to bytes clamped at 0xFF, which matches none of the characters
+
+    __attribute__((target("sse4.2")))
+    inline std::uint64_t equal_sse42(const __m128i b, const char c) noexcept {
+        return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(b, _mm_set1_epi8(c))));
+    }
+
+    template<typename CharT>
+    __attribute__((target("sse4.2")))
+    masks sse42(const CharT *p) noexcept {
+        masks m;
+        for (unsigned i = 0; i < 64; i += 16) {
+            const __m128i b = xml_scan_detail::load16_sse42(p + i);
+            m.lt |= equal_sse42(b, '<') << i;
+            m.gt |= equal_sse42(b, '>') << i;
+            m.quot |= equal_sse42(b, '"') << i;
+            m.apos |= equal_sse42(b, '\'') << i;
+            m.amp |= equal_sse42(b, '&') << i;
+            m.rsqb |= equal_sse42(b, ']') << i;
+        }
+        return m;
+    }
+
+    __attribute__((target("avx2")))
+    inline std::uint64_t equal_avx2(const __m256i b, const char c) noexcept {
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, _mm256_set1_epi8(c))));
+    }
+
+    template<typename CharT>
+    __attribute__((target("avx2")))
+    masks avx2(const CharT *p) noexcept {
+        masks m;
+        for (unsigned i = 0; i < 64; i += 32) {
+            const __m256i b = xml_scan_detail::load32_avx2(p + i);
+            m.lt |= equal_avx2(b, '<') << i;
+            m.gt |= equal_avx2(b, '>') << i;
+            m.quot |= equal_avx2(b, '"') << i;
+            m.apos |= equal_avx2(b, '\'') << i;
+            m.amp |= equal_avx2(b, '&') << i;
+            m.rsqb |= equal_avx2(b, ']') << i;
+        }
+        return m;
+    }
+
+#if !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+    template<typename CharT>
+    __attribute__((target("avx512f,avx512bw")))
+    masks avx512(const CharT *p) noexcept {
+        const __m512i b = xml_scan_detail::load64_avx512(p);
+        masks m;
+        m.lt = _mm512_cmpeq_epi8_mask(b, _mm512_set1_epi8('<'));
+        m.gt = _mm512_cmpeq_epi8_mask(b, _mm512_set1_epi8('>'));
+        m.quot = _mm512_cmpeq_epi8_mask(b, _mm512_set1_epi8('"'));
+        m.apos = _mm512_cmpeq_epi8_mask(b, _mm512_set1_epi8('\''));
+        m.amp = _mm512_cmpeq_epi8_mask(b, _mm512_set1_epi8('&'));
+        m.rsqb = _mm512_cmpeq_epi8_mask(b, _mm512_set1_epi8(']'));
+        return m;
+    }
+
+#if !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+}
+
+///  Where the markup of a document is.  Markup i runs from start(i) to end(i), one past its '>', and the text after it
+///  runs to start(i + 1).  start(size()) is the length of the document.  plain(i) is true when that text holds no '&'
+///  or ']', so it needs neither decoding nor checking for "]]>".
+///
+///  A quote only delimits inside a tag and a '>' only closes a comment after "--", so the quote and comment regions
+///  can not be resolved from the masks alone with the prefix XOR used for JSON.  They are resolved by following the
+///  state from block to block instead, jumping from one set bit to the next, so the cost is per markup character and
+///  the text between is never looked at again.  Markup that is not closed by the end of the document has no end.
+///
+///  build() reuses the memory of the last build.
+template<typename CharT = char>
+class xml_structural_index {
+public:
+    using view_type = std::basic_string_view<CharT>;
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    void build(const view_type sv) { build(sv, xml_scan_dispatch::level()); }
+
+    ///  with the kernel for l, or the widest the cpu supports when it does not support l
+    void build(const view_type sv, scan_level l) {
+        if (!xml_scan_dispatch::supported(l)) l = xml_scan_dispatch::level();
+        switch (l) {
+#ifdef XML_PARSER_SIMD_X86
+            case scan_level::avx512:
+                return build(sv, [](const CharT *p) { return xml_index_detail::avx512(p); });
+            case scan_level::avx2:
+                return build(sv, [](const CharT *p) { return xml_index_detail::avx2(p); });
+            case scan_level::sse42:
+                return build(sv, [](const CharT *p) { return xml_index_detail::sse42(p); });
+#endif
+            case scan_level::scalar:
+            default:
+                return build(sv, [](const CharT *p) { return xml_index_detail::scalar(p); });
+        }
+    }
+
+    ///  the markup found
+    [[nodiscard]] std::size_t size() const noexcept { return m_offsets.size() / 2; }
+
+    [[nodiscard]] std::size_t start(std::size_t i) const noexcept { return m_offsets[2 * i]; }
+
+    ///  npos when the markup is not closed
+    [[nodiscard]] std::size_t end(std::size_t i) const noexcept {
+        const auto out = m_offsets[2 * i + 1] & ~checked;
+        return out == (npos & ~checked) ? npos : out;
+    }
+
+    [[nodiscard]] bool plain(std::size_t i) const noexcept { return !(m_offsets[2 * i + 1] & checked); }
+
+    void clear() noexcept { m_offsets.clear(); }
+
+private:
+    //  on the end of a markup, the text after it holds a '&' or ']'
+    static constexpr std::uint64_t checked = std::uint64_t(1) << 63u;
+
+    //  what the last code unit of the last block was part of
+    enum class state : std::uint8_t {
+        text,
+        tag,
+        quot,       //  a value in a tag
+        apos,
+        comment,
+        cdata,
+        pi
+    };
+
+    template<typename Classify>
+    void build(const view_type sv, Classify &&classify) {
+        m_offsets.clear();
+        m_state = state::text;
+        m_coded = false;
+
+        const auto n = sv.length();
+        std::size_t base = 0;
+        for (; base + 64 <= n; base += 64) resolve(sv, base, classify(sv.data() + base));
+        if (base < n) {
+            std::array<CharT, 64> tail{};
+            for (std::size_t i = base; i < n; ++i) tail[i - base] = sv[i];
+            resolve(sv, base, classify(tail.data()));
+        }
+
+        //  an unclosed markup has no end, and whatever follows the last one runs to the end of the document
+        if (m_state != state::text) m_offsets.push_back(npos & ~checked);
+        if (m_coded && !m_offsets.empty()) m_offsets.back() |= checked;
+        m_offsets.push_back(n);
+    }
+
+    ///  follow the state through the block of masks m at base
+    void resolve(const view_type sv, const std::size_t base, const xml_index_detail::masks &m) {
+        unsigned cur = 0;
+        while (cur < 64) {
+            const auto above = ~std::uint64_t(0) << cur;
+            unsigned i;
+            switch (m_state) {
+                case state::text: {
+                    const auto lt = m.lt & above;
+                    const auto coded = (m.amp | m.rsqb) & above;
+                    if (!lt) {
+                        m_coded |= coded != 0;
+                        return;
+                    }
+                    i = static_cast<unsigned>(__builtin_ctzll(lt));
+                    m_coded |= (coded & ((std::uint64_t(1) << i) - 1)) != 0;
+                    open(sv, base + i);
+                    break;
+                }
+
+                case state::tag: {
+                    const auto stop = (m.gt | m.quot | m.apos) & above;
+                    if (!stop) return;
+                    i = static_cast<unsigned>(__builtin_ctzll(stop));
+                    const auto bit = std::uint64_t(1) << i;
+                    if (m.gt & bit) close(base + i);
+                    else m_state = m.quot & bit ? state::quot : state::apos;
+                    break;
+                }
+
+                case state::quot:
+                case state::apos: {
+                    const auto stop = (m_state == state::quot ? m.quot : m.apos) & above;
+                    if (!stop) return;
+                    i = static_cast<unsigned>(__builtin_ctzll(stop));
+                    m_state = state::tag;
+                    break;
+                }
+
+                default: {
+                    auto stop = m.gt & above;
+                    for (; stop; stop &= stop - 1) {
+                        i = static_cast<unsigned>(__builtin_ctzll(stop));
+                        if (closes(sv, base + i)) break;
+                    }
+                    if (!stop) return;
+                    close(base + i);
+                }
+            }
+            cur = i + 1;
+        }
+    }
+
+    ///  markup starts at the '<' at pos
+    void open(const view_type sv, const std::size_t pos) {
+        if (m_coded && !m_offsets.empty()) m_offsets.back() |= checked;
+        m_coded = false;
+        m_offsets.push_back(pos);
+        m_markup = pos;
+
+        const auto markup = sv.substr(pos);
+        if (xml_const_compare(markup, "<!--")) m_state = state::comment;
+        else if (xml_const_compare(markup, "<![CDATA[")) m_state = state::cdata;
+        else if (xml_const_compare(markup, "<?")) m_state = state::pi;
+        else m_state = state::tag;
+    }
+
+    ///  the markup ends with the '>' at pos
+    void close(const std::size_t pos) {
+        m_offsets.push_back(pos + 1);
+        m_state = state::text;
+    }
+
+    ///  whether the '>' at pos closes the comment, CDATA section or PI open
+    bool closes(const view_type sv, const std::size_t pos) const noexcept {
+        switch (m_state) {
+            case state::comment:
+                return pos >= m_markup + 6 && sv[pos - 1] == CharT('-') && sv[pos - 2] == CharT('-');
+            case state::cdata:
+                return pos >= m_markup + 11 && sv[pos - 1] == CharT(']') && sv[pos - 2] == CharT(']');
+            default:
+                return pos >= m_markup + 3 && sv[pos - 1] == CharT('?');
+        }
+    }
+
+    std::vector<std::uint64_t> m_offsets;   //  start and end of each markup, then the length
+    state m_state = state::text;
+    bool m_coded = false;                   //  the text since the last markup holds a '&' or ']'
+    std::size_t m_markup = 0;               //  where the markup open started
+};
+
+#endif //PARSER_XML_INDEX_H
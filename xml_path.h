@@ -0,0 +1,308 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_PATH_H
+#define PARSER_XML_PATH_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "jacob_parser.h"
+#include "xml_sax.h"
+
+template<typename CharT>
+class xml_path;
+
+template<typename CharT, typename Trace>
+class xml_subtree_filter;
+
+///  The elements an xml_path selected, in document order, and the scratch space it selected them with.  Reused for
+///  query after query a node set stops allocating once it has grown to the largest of them.  The nodes are those of
+///  the tree the path ran over and go with it
+template<typename CharT = char>
+class xml_node_set {
+public:
+    using const_iterator = const xml_node<CharT> *const *;
+
+    [[nodiscard]] const_iterator begin() const noexcept { return m_nodes.data(); }
+
+    [[nodiscard]] const_iterator end() const noexcept { return m_nodes.data() + m_nodes.size(); }
+
+    [[nodiscard]] std::size_t size() const noexcept { return m_nodes.size(); }
+
+    [[nodiscard]] bool empty() const noexcept { return m_nodes.empty(); }
+
+    const xml_node<CharT> &operator[](std::size_t i) const noexcept { return *m_nodes[i]; }
+
+    ///  the first node selected, or nullptr
+    [[nodiscard]] const xml_node<CharT> *front() const noexcept { return m_nodes.empty() ? nullptr : m_nodes.front(); }
+
+    void clear() noexcept { m_nodes.clear(); }
+
+private:
+    friend class xml_path<CharT>;
+
+    using node_container = std::decay_t<decltype(std::declval<const xml_node<CharT> &>().children())>;
+
+    ///  a node whose children are being walked
+    struct frame {
+        typename node_container::const_iterator next;
+        typename node_container::const_iterator end;
+        std::uint64_t states;       //  the steps the children may match
+        std::size_t counters;       //  where its position counters start in m_counters
+    };
+
+    std::vector<const xml_node<CharT> *> m_nodes;
+    std::vector<frame> m_frames;
+    std::vector<std::uint32_t> m_counters;
+};
+
+///  A compiled path expression, the subset of XPath 1.0 abbreviated syntax that selects elements:
+///      /feed/item                  children, a leading / is the node the path runs over
+///      //item  feed//title         descendants
+///      *                           any element
+///      item[@id]                   items with an id attribute
+///      item[@type='x']             ... with type x,  [@type!='x'] without
+///      item[2]                     the second item of its parent, counting from 1
+///  Predicates apply in order, so item[@type='x'][2] is the second of the items with type x.
+///
+///  Compile once and select as often as needed.  select() does not change the path, so threads may share one, each
+///  with a node set of its own.  A selection walks the tree once and matches every step at once, so it costs one pass
+///  whatever the path.
+template<typename CharT = char>
+class xml_path {
+public:
+    using view_type = std::basic_string_view<CharT>;
+    using string_type = std::basic_string<CharT>;
+    using xml_result = result<std::size_t, xml_error>;
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+    static constexpr std::size_t max_steps = 64;
+
+    xml_path() = default;
+
+    ///  compile expr, see valid()
+    explicit xml_path(const view_type expr) { compile(expr); }
+
+    ///  The length of expr, or npos when it is not a path this understands.  A path that fails to compile selects
+    ///  nothing
+    xml_result compile(const view_type expr) {
+        m_steps.clear();
+        m_predicates.clear();
+        m_counters = 0;
+        m_expr.assign(expr);    //  NUL terminated, so the scan may look one past the end
+        auto out = parse();
+        if (out) {
+            m_steps.clear();
+            m_predicates.clear();
+            m_counters = 0;
+        }
+        return out;
+    }
+
+    [[nodiscard]] bool valid() const noexcept { return !m_steps.empty(); }
+
+    [[nodiscard]] view_type expression() const noexcept { return m_expr; }
+
+    ///  The elements below context the path selects, in document order, into *out which is returned.  context is
+    ///  usually xml_document::root(), the document node
+    const xml_node_set<CharT> &select(const xml_node<CharT> &context, xml_node_set<CharT> *out) const {
+        out->m_nodes.clear();
+        out->m_frames.clear();
+        out->m_counters.clear();
+        if (m_steps.empty()) return *out;
+
+        push(out, context, 1);
+        while (!out->m_frames.empty()) {
+            auto &f = out->m_frames.back();
+            if (f.next == f.end) {
+                out->m_counters.resize(f.counters);
+                out->m_frames.pop_back();
+                continue;
+            }
+            const auto &node = *f.next++;
+            if (node.type() != node_type::element) continue;
+
+            std::uint64_t next = 0;
+            bool selected = false;
+            for (auto states = f.states; states; states &= states - 1) {
+                const auto i = static_cast<std::size_t>(__builtin_ctzll(states));
+                const auto &s = m_steps[i];
+                if (s.descendant) next |= std::uint64_t(1) << i;
+                if (!matches(s, node, out->m_counters.data() + f.counters)) continue;
+                if (i + 1 == m_steps.size()) selected = true;
+                else next |= std::uint64_t(1) << (i + 1);
+            }
+            if (selected) out->m_nodes.push_back(&node);
+            if (next) push(out, node, next);    //  f is not used past here, the push may move it
+        }
+        return *out;
+    }
+
+private:
+    template<typename C, typename Trace>
+    friend class xml_subtree_filter;
+
+    enum class predicate_kind : std::uint8_t {
+        has_attribute,
+        attribute_equals,
+        attribute_not_equals,
+        position
+    };
+
+    struct predicate {
+        predicate_kind kind;
+        string_type name;
+        string_type value;
+        std::size_t position;   //  from 1
+        std::size_t counter;    //  of a position predicate, its index among a frame's counters
+    };
+
+    struct step {
+        string_type name;       //  empty for *
+        bool descendant;        //  after //, so it may match at any depth below the step before it
+        std::size_t first;      //  its predicates
+        std::size_t count;
+    };
+
+    void push(xml_node_set<CharT> *out, const xml_node<CharT> &node, std::uint64_t states) const {
+        const auto &children = node.children();
+        if (children.empty()) return;
+        out->m_frames.push_back({children.begin(), children.end(), states, out->m_counters.size()});
+        out->m_counters.resize(out->m_counters.size() + m_counters, 0);
+    }
+
+    static std::optional<view_type> attribute(const xml_node<CharT> &node, const view_type name) {
+        const auto it = node.attributes().find(name);
+        if (it == node.attributes().end()) return std::nullopt;
+        return it->second.view();
+    }
+
+    ///  the tag's values must have been decoded
+    static std::optional<view_type> attribute(const xml_tag_buffer<CharT> &tag, const view_type name) {
+        const auto a = tag.find(name);
+        if (!a) return std::nullopt;
+        return a->value;
+    }
+
+    ///  whether matching step s looks at attributes
+    bool tests_attributes(const step &s) const noexcept {
+        for (std::size_t i = s.first; i < s.first + s.count; ++i)
+            if (m_predicates[i].kind != predicate_kind::position) return true;
+        return false;
+    }
+
+    ///  Element is an xml_node or an xml_tag_buffer.  counters are the position counters of its parent
+    template<typename Element>
+    bool matches(const step &s, const Element &element, std::uint32_t *counters) const {
+        if (!s.name.empty() && element.name() != view_type(s.name)) return false;
+        for (std::size_t i = s.first; i < s.first + s.count; ++i) {
+            const auto &p = m_predicates[i];
+            if (p.kind == predicate_kind::position) {
+                if (++counters[p.counter] != p.position) return false;
+                continue;
+            }
+            const auto value = attribute(element, p.name);
+            if (!value) return false;
+            if (p.kind == predicate_kind::attribute_equals && *value != view_type(p.value)) return false;
+            if (p.kind == predicate_kind::attribute_not_equals && *value == view_type(p.value)) return false;
+        }
+        return true;
+    }
+
+    //  ************ the expression ********************
+    using grammar = xml_traits<CharT>;
+
+    ///  the expression with its NUL, which stops the productions at the end
+    view_type text() const { return view_type(m_expr.c_str(), m_expr.length() + 1); }
+
+    void skip_space(std::size_t *pos) const { *pos += grammar::S(text().substr(*pos)); }
+
+    ///  a Name at *pos, empty when there is none
+    view_type name(std::size_t *pos) const {
+        const auto start = *pos;
+        if (!grammar::NameStartChar::contains(m_expr[start])) return view_type();
+        auto end = start + 1;
+        while (end < m_expr.length() && grammar::NameChar::contains(m_expr[end])) ++end;
+        *pos = end;
+        return text().substr(start, end - start);
+    }
+
+    xml_result parse() {
+        const auto sv = text();
+        std::size_t pos = 0;
+        bool descendant = false;
+        if (xml_const_compare(sv, "//")) {
+            descendant = true;
+            pos = 2;
+        } else if (sv[0] == CharT('/')) {
+            pos = 1;
+        }
+
+        for (;;) {
+            if (m_steps.size() == max_steps) return {npos, xml_error::unexpected};
+            step s{string_type(), descendant, m_predicates.size(), 0};
+            if (m_expr[pos] == CharT('*')) {
+                ++pos;
+            } else {
+                const auto n = name(&pos);
+                if (n.empty()) return {npos, xml_error::unexpected};
+                s.name.assign(n);
+            }
+
+            //  predicates
+            while (m_expr[pos] == CharT('[')) {
+                ++pos;
+                skip_space(&pos);
+                predicate p{predicate_kind::has_attribute, string_type(), string_type(), 0, 0};
+                if (m_expr[pos] == CharT('@')) {
+                    ++pos;
+                    const auto n = name(&pos);
+                    if (n.empty()) return {npos, xml_error::unexpected};
+                    p.name.assign(n);
+                    skip_space(&pos);
+                    if (m_expr[pos] == CharT('=') || (m_expr[pos] == CharT('!') && m_expr[pos + 1] == CharT('='))) {
+                        p.kind = m_expr[pos] == CharT('=') ? predicate_kind::attribute_equals
+                                                           : predicate_kind::attribute_not_equals;
+                        pos += p.kind == predicate_kind::attribute_equals ? 1 : 2;
+                        skip_space(&pos);
+                        const auto quote = m_expr[pos];
+                        if (quote != CharT('\'') && quote != CharT('"')) return {npos, xml_error::unexpected};
+                        const auto close = sv.find(quote, pos + 1);
+                        if (close == view_type::npos) return {npos, xml_error::unexpected};
+                        p.value.assign(sv.substr(pos + 1, close - pos - 1));
+                        pos = close + 1;
+                    }
+                } else {
+                    std::size_t end = pos;
+                    while (m_expr[end] >= CharT('0') && m_expr[end] <= CharT('9')) ++end;
+                    if (end == pos || end - pos > 9) return {npos, xml_error::unexpected};
+                    for (; pos < end; ++pos) p.position = p.position * 10 + static_cast<std::size_t>(m_expr[pos] - CharT('0'));
+                    if (p.position == 0) return {npos, xml_error::unexpected};
+                    p.kind = predicate_kind::position;
+                    p.counter = m_counters++;
+                }
+                skip_space(&pos);
+                if (m_expr[pos] != CharT(']')) return {npos, xml_error::unexpected};
+                ++pos;
+                m_predicates.push_back(std::move(p));
+                ++s.count;
+            }
+            m_steps.push_back(std::move(s));
+
+            if (pos == m_expr.length()) return {pos, std::error_condition()};
+            if (m_expr[pos] != CharT('/')) return {npos, xml_error::unexpected};
+            descendant = m_expr[pos + 1] == CharT('/');
+            pos += descendant ? 2 : 1;
+        }
+    }
+
+    string_type m_expr;
+    std::vector<step> m_steps;
+    std::vector<predicate> m_predicates;
+    std::size_t m_counters = 0;     //  position predicates, each frame counts for every one of them
+};
+
+#endif //PARSER_XML_PATH_H
@@ -0,0 +1,147 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_POOL_H
+#define PARSER_XML_POOL_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "jacob_parser.h"
+
+///  Documents kept warm for reuse.  A document handed back is cleared, which rewinds its arena and empties its atom
+///  table but keeps the memory of both, so a server parsing one request after another settles into parsing without
+///  allocating, and what a document holds is bounded by the largest request it parsed.
+///
+///  The pool is a fixed row of slots, each claimed with one compare and swap, no lock is taken.  A thread starts
+///  looking at a slot picked by its id, so while there are slots enough each thread keeps coming back to the same warm
+///  document.  When every slot is taken acquire() makes a document that is thrown away on release.
+template<typename CharT = char, std::size_t Buff = 4096, typename Trace = xml_null_trace>
+class xml_document_pool {
+public:
+    using document_type = xml_document<CharT, Buff, Trace>;
+
+    ///  a document on loan from the pool, returned when the lease is destroyed
+    class lease {
+    public:
+        lease() = default;
+
+        lease(const lease &) = delete;
+
+        lease &operator=(const lease &) = delete;
+
+        lease(lease &&other) noexcept : m_pool(other.m_pool), m_doc(other.m_doc), m_slot(other.m_slot) {
+            other.m_pool = nullptr;
+            other.m_doc = nullptr;
+        }
+
+        lease &operator=(lease &&other) noexcept {
+            if (this != &other) {
+                release();
+                m_pool = other.m_pool;
+                m_doc = other.m_doc;
+                m_slot = other.m_slot;
+                other.m_pool = nullptr;
+                other.m_doc = nullptr;
+            }
+            return *this;
+        }
+
+        ~lease() { release(); }
+
+        ///  hand the document back early
+        void release() {
+            if (m_pool) m_pool->give_back(m_doc, m_slot);
+            m_pool = nullptr;
+            m_doc = nullptr;
+        }
+
+        explicit operator bool() const noexcept { return m_doc != nullptr; }
+
+        document_type &operator*() const noexcept { return *m_doc; }
+
+        document_type *operator->() const noexcept { return m_doc; }
+
+        document_type *get() const noexcept { return m_doc; }
+
+    private:
+        friend class xml_document_pool;
+
+        lease(xml_document_pool *pool, document_type *doc, std::size_t slot) noexcept :
+                m_pool(pool), m_doc(doc), m_slot(slot) {}
+
+        xml_document_pool *m_pool = nullptr;
+        document_type *m_doc = nullptr;
+        std::size_t m_slot = 0;
+    };
+
+    ///  slots defaults to one per hardware thread.  Every document is made with options and parses in mode
+    explicit xml_document_pool(std::size_t slots = 0, const xml_arena_options &options = {},
+                               parse_mode mode = parse_mode::copy) :
+            m_slots(slots ? slots : std::max(1u, std::thread::hardware_concurrency())),
+            m_options(options), m_mode(mode) {}
+
+    xml_document_pool(const xml_document_pool &) = delete;
+
+    xml_document_pool &operator=(const xml_document_pool &) = delete;
+
+    ///  Every lease must be returned before the pool is destroyed
+    ~xml_document_pool() = default;
+
+    ///  a cleared document
+    lease acquire() {
+        const auto n = m_slots.size();
+        const auto start = std::hash<std::thread::id>()(std::this_thread::get_id()) % n;
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto slot = (start + i) % n;
+            auto &s = m_slots[slot];
+            bool busy = false;
+            if (s.m_busy.load(std::memory_order_relaxed) ||
+                !s.m_busy.compare_exchange_strong(busy, true, std::memory_order_acquire))
+                continue;
+            //  only the holder of the slot touches its document
+            if (!s.m_doc) s.m_doc = make_document();
+            return {this, s.m_doc.get(), slot};
+        }
+        m_overflow.fetch_add(1, std::memory_order_relaxed);
+        return {this, make_document().release(), npos};
+    }
+
+    [[nodiscard]] std::size_t slots() const noexcept { return m_slots.size(); }
+
+    ///  times acquire() found every slot taken
+    [[nodiscard]] std::size_t overflow() const noexcept { return m_overflow.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    struct alignas(64) slot {   //  one per cache line, threads claiming neighbours do not share one
+        std::atomic<bool> m_busy{false};
+        std::unique_ptr<document_type> m_doc;
+    };
+
+    std::unique_ptr<document_type> make_document() {
+        auto doc = std::make_unique<document_type>(m_options);
+        doc->set_mode(m_mode);
+        return doc;
+    }
+
+    void give_back(document_type *doc, std::size_t slot) {
+        if (slot == npos) {
+            delete doc;
+            return;
+        }
+        doc->clear();
+        m_slots[slot].m_busy.store(false, std::memory_order_release);
+    }
+
+    std::vector<slot> m_slots;
+    xml_arena_options m_options;
+    parse_mode m_mode;
+    std::atomic<std::size_t> m_overflow{0};
+};
+
+#endif //PARSER_XML_POOL_H
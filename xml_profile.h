@@ -0,0 +1,137 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_PROFILE_H
+#define PARSER_XML_PROFILE_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+//  xml_profile depends on production, jacob_parser.h includes it after xml_trace.h
+
+///  Where the time of a parse went, production by production.  Filled in by xml_profile_trace
+struct xml_parse_profile {
+    static constexpr std::size_t productions = static_cast<std::size_t>(production::Document) + 1;
+
+    struct counters {
+        std::uint64_t calls = 0;
+        std::uint64_t failures = 0;
+        std::uint64_t bytes = 0;        //  consumed by the calls that succeeded
+        std::uint64_t cycles = 0;       //  from enter to leave, including the productions it called.  Nested
+                                        //  elements are counted again in each element around them
+        std::uint64_t self_cycles = 0;  //  less the productions it called
+    };
+
+    std::array<counters, productions> by_production{};
+    std::size_t max_depth = 0;          //  of nested elements
+
+    const counters &operator[](production p) const noexcept { return by_production[static_cast<std::size_t>(p)]; }
+
+    void clear() noexcept { *this = xml_parse_profile(); }
+};
+
+std::ostream &operator<<(std::ostream &lhs, const xml_parse_profile &rhs) {
+    lhs << std::left << std::setw(16) << "production" << std::right
+        << std::setw(12) << "calls" << std::setw(10) << "failures" << std::setw(14) << "bytes"
+        << std::setw(16) << "cycles" << std::setw(16) << "self cycles" << '\n';
+    for (std::size_t i = 0; i < rhs.by_production.size(); ++i) {
+        const auto &c = rhs.by_production[i];
+        if (!c.calls) continue;
+        lhs << std::left << std::setw(16) << static_cast<production>(i) << std::right
+            << std::setw(12) << c.calls << std::setw(10) << c.failures << std::setw(14) << c.bytes
+            << std::setw(16) << c.cycles << std::setw(16) << c.self_cycles << '\n';
+    }
+    return lhs << "max depth : " << rhs.max_depth << '\n';
+}
+
+///  Trace policy that profiles every production into the xml_parse_profile attached to the parsing thread.
+///  xml_document attaches its own for the length of each parse, see xml_document::profile()
+///      xml_document<char, 4096, xml_profile_trace> doc;
+///      doc.parse(text);
+///      std::cout << doc.profile();
+///
+///  Time is counted in TSC cycles where there is a TSC, and in steady_clock nanoseconds elsewhere.  A production's
+///  cycles include the two clock reads of each production it calls, so self_cycles is the truer figure for the small
+///  ones.
+struct xml_profile_trace {
+    static std::uint64_t now() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    ///  profile is filled in by this thread until detach, nullptr detaches
+    static void attach(xml_parse_profile *profile) noexcept {
+        auto &s = state();
+        s.profile = profile;
+        s.frames.clear();
+        s.depth = 0;
+    }
+
+    static void enter(production p) {
+        auto &s = state();
+        if (!s.profile) return;
+        if (p == production::Element && ++s.depth > s.profile->max_depth) s.profile->max_depth = s.depth;
+        s.frames.push_back({now(), 0});
+    }
+
+    static void leave(production p, std::size_t bytes) noexcept {
+        auto &s = state();
+        if (!s.profile || s.frames.empty()) return;
+        const auto end = now();
+        const auto frame = s.frames.back();
+        s.frames.pop_back();
+        const auto cycles = end - frame.start;
+
+        auto &c = s.profile->by_production[static_cast<std::size_t>(p)];
+        ++c.calls;
+        if (bytes == static_cast<std::size_t>(-1)) ++c.failures; else c.bytes += bytes;
+        c.cycles += cycles;
+        c.self_cycles += cycles - frame.children;
+        if (!s.frames.empty()) s.frames.back().children += cycles;
+        if (p == production::Element) --s.depth;
+    }
+
+    static constexpr void node(node_type) noexcept {}
+
+private:
+    struct frame {
+        std::uint64_t start;
+        std::uint64_t children;     //  cycles spent in the productions it called
+    };
+
+    struct thread_state {
+        xml_parse_profile *profile = nullptr;
+        std::vector<frame> frames;
+        std::size_t depth = 0;
+    };
+
+    static thread_state &state() noexcept {
+        thread_local thread_state s;
+        return s;
+    }
+};
+
+///  true when Trace profiles into an attached xml_parse_profile
+template<typename Trace, typename = void>
+struct xml_trace_profiles : std::false_type {
+};
+
+template<typename Trace>
+struct xml_trace_profiles<Trace, std::void_t<decltype(Trace::attach(static_cast<xml_parse_profile *>(nullptr)))>>
+        : std::true_type {
+};
+
+#endif //PARSER_XML_PROFILE_H
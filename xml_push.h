@@ -0,0 +1,320 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_PUSH_H
+#define PARSER_XML_PUSH_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "jacob_parser.h"
+#include "xml_sax.h"
+
+///  A sax parser fed the document a piece at a time, for input that arrives from a pipe or a socket.
+///  feed() parses every token that is complete so far and keeps only the unfinished tail, finish() ends the document.
+///  Handler is the same as for xml_sax_parser.
+///
+///  A token is only parsed once all of it has arrived, the productions can then look ahead as they do on a whole
+///  document.  Until then the parser remembers what kind of token it is in and how far it has searched for the end,
+///  so a name, attribute value, reference or terminator split across feeds costs no rescanning.  Text is handed on
+///  as it arrives, less any reference or ']' at its end that the next feed may complete.
+template<typename CharT, typename Handler, typename Trace = xml_null_trace>
+class xml_push_parser {
+    using grammar = xml_traits<CharT, Trace>;
+    using xml_result = result<std::size_t, xml_error>;
+    using view_type = std::basic_string_view<CharT>;
+
+    static constexpr std::size_t npos = grammar::npos;
+
+public:
+    explicit xml_push_parser(Handler &handler) : m_handler(handler) {}
+
+    ///  parse as much of the document as chunk completes, false once the document is in error
+    bool feed(const view_type chunk) {
+        if (m_error) return false;
+        m_buf.append(chunk.data(), chunk.length());
+        drain(false);
+
+        //  keep only the unconsumed tail, m_scan is relative to the pending token so it still holds
+        m_consumed += m_pos;
+        m_buf.erase(0, m_pos);
+        m_pos = 0;
+        return !m_error;
+    }
+
+    ///  the end of the document, same return as xml_document::parse: the length parsed or npos on error
+    std::size_t finish() {
+        if (!m_error) drain(true);
+        if (!m_error && (!m_open.empty() || m_pos != m_buf.length())) m_error = true;
+        return m_error ? npos : m_consumed + m_pos;
+    }
+
+    ///  start over on a new document, after finish() or an error
+    void reset() {
+        m_buf.clear();
+        m_pos = 0;
+        m_consumed = 0;
+        m_scan = npos;
+        m_quote = CharT();
+        m_open.clear();
+        m_names.clear();
+        m_started = false;
+        m_error = false;
+    }
+
+    ///  offset into the whole document of the next token, where it stopped on an error
+    [[nodiscard]] std::size_t offset() const noexcept { return m_consumed + m_pos; }
+
+    ///  code units held back waiting for the rest of a token
+    [[nodiscard]] std::size_t buffered() const noexcept { return m_buf.length() - m_pos; }
+
+private:
+    ///  decoding output that hands the text straight to the handler
+    struct text_writer {
+        Handler &m_handler;
+
+        void append(const CharT *p, std::size_t n) { if (n) m_handler.characters(view_type(p, n)); }
+
+        void append(const view_type v) { append(v.data(), v.length()); }
+
+        text_writer &operator+=(const CharT c) {
+            append(&c, 1);
+            return *this;
+        }
+    };
+
+    void fail() noexcept { m_error = true; }
+
+    ///  parse every complete token from m_pos, at_end when no more input is coming
+    void drain(const bool at_end) {
+        const view_type buf(m_buf);
+        while (!m_error && m_pos < buf.length()) {
+            const view_type sv = buf.substr(m_pos);
+
+            if (sv[0] != CharT('<')) {
+                if (!text(sv, at_end)) return;
+                continue;
+            }
+
+            const auto len = extent(sv);
+            if (len == npos) return;    //  wait for more
+            m_scan = npos;
+            m_quote = CharT();
+            m_pos += markup(sv, len);
+        }
+    }
+
+    ///  Length of the markup at the front of sv, or npos when it has not all arrived.  m_scan, relative to sv, is how
+    ///  far a previous call already searched for the end
+    std::size_t extent(const view_type sv) {
+        if (sv.length() < 2) return npos;
+
+        //  the end of the markup follows the first terminator at or after from
+        auto terminated = [&](std::size_t from, const auto &find, const char *term, std::size_t term_len) {
+            const auto begin = m_scan == npos ? from : std::max(from, m_scan);
+            const auto end = find(sv.substr(begin), term);
+            if (end != npos && begin + end + term_len <= sv.length()) return begin + end + term_len;
+            m_scan = sv.length() >= term_len ? std::max(from, sv.length() - term_len + 1) : from;
+            return npos;
+        };
+        auto comment_find = [](const view_type v, const char *t) { return grammar::Char_Comment_::find(v, t); };
+        auto pi_find = [](const view_type v, const char *t) { return grammar::Char_PI_::find(v, t); };
+        auto cdata_find = [](const view_type v, const char *t) { return grammar::Char_CDATA_::find(v, t); };
+
+        switch (sv[1]) {
+            case CharT('?'):
+                return terminated(2, pi_find, "?>", 2);
+
+            case CharT('!'):
+                if (sv.length() < 4) return npos;
+                if (sv[2] == CharT('-')) {
+                    //  '--' may only appear as part of the closing '-->', Comment reports it when it is not
+                    return terminated(4, comment_find, "--", 3);
+                }
+                if (sv.length() < 9) return npos;
+                if (xml_const_compare(sv, "<![CDATA[")) return terminated(9, cdata_find, "]]>", 3);
+                return 2;   //  not supported, markup() reports it
+
+            default: {
+                //  a tag, ends at the first '>' outside a quoted value
+                std::size_t pos = m_scan == npos ? 1 : m_scan;
+                for (;;) {
+                    if (m_quote != CharT()) {
+                        const auto end = sv.find(m_quote, pos);
+                        if (end == npos) {
+                            m_scan = sv.length();
+                            return npos;
+                        }
+                        m_quote = CharT();
+                        pos = end + 1;
+                    }
+                    auto t_out = grammar::TagClose_::skip(sv.substr(pos));
+                    if (t_out) {
+                        m_scan = sv.length();
+                        return npos;
+                    }
+                    pos += t_out;
+                    if (sv[pos] == CharT('>')) return pos + 1;
+                    m_quote = sv[pos++];
+                }
+            }
+        }
+    }
+
+    ///  parse the complete markup at the front of sv, len long.  Returns the length parsed
+    std::size_t markup(const view_type sv, const std::size_t len) {
+        const bool first = !m_started;
+        m_started = true;
+        xml_result t_out{npos, xml_error::unexpected};
+
+        //  identify_node_type takes an end tag for an element
+        const auto nt = sv[1] == CharT('/') ? node_type::unknown : identify_node_type<CharT>(sv);
+        switch (nt) {
+            case node_type::element: {
+                m_tag.clear();
+                auto out = grammar::Stag_Emptytag(&m_tag, sv);
+                if (out.second) break;
+                m_tag.decode();
+                m_handler.start_element(m_tag.name(), m_tag.attributes());
+                if (out.first) {
+                    m_handler.end_element(m_tag.name());
+                } else {
+                    m_open.push_back(m_names.length());
+                    m_names.append(m_tag.name());
+                }
+                t_out = out.second;
+                break;
+            }
+
+            case node_type::comment: {
+                if (sv[3] != CharT('-')) break;
+                auto cnt = grammar::Char_Comment(sv.substr(4));
+                if (cnt) break;
+                m_handler.comment(sv.substr(4, cnt));
+                t_out = {4 + cnt + 3, std::error_condition()};
+                break;
+            }
+
+            case node_type::pi: {
+                std::size_t pos = 2;
+                auto t_target = grammar::PITarget(sv.substr(pos));
+                if (t_target) break;
+                pos += t_target;
+                pos += grammar::S(sv.substr(pos));
+                auto t_data = grammar::Char_PI(sv.substr(pos));
+                if (t_data) break;
+                m_handler.pi(sv.substr(2, t_target), sv.substr(pos, t_data));
+                t_out = {pos + t_data + 2, std::error_condition()};
+                break;
+            }
+
+            case node_type::cdata: {
+                auto t_data = grammar::Char_CDATA(sv.substr(9));
+                if (t_data) break;
+                m_handler.cdata(sv.substr(9, t_data));
+                t_out = {9 + t_data + 3, std::error_condition()};
+                break;
+            }
+
+            case node_type::xmldecl: {
+                if (!first) break;
+                m_tag.clear();
+                t_out = grammar::XMLDecl(&m_tag, sv);
+                if (!t_out) m_handler.xml_declaration(m_tag.attributes());
+                break;
+            }
+
+            default:
+                if (sv[1] == CharT('/')) t_out = end_tag(sv);
+                break;
+        }
+
+        if (t_out || t_out != len) {
+            fail();
+            return 0;
+        }
+        return len;
+    }
+
+    xml_result end_tag(const view_type sv) {
+        if (m_open.empty()) return {npos, xml_error::unexpected};
+        const view_type name = view_type(m_names).substr(m_open.back());
+        auto t_out = grammar::Etag(name, sv);
+        if (t_out) return {npos, xml_error::unexpected};
+        m_handler.end_element(name);
+        m_names.erase(m_open.back());
+        m_open.pop_back();
+        return t_out;
+    }
+
+    ///  Consume text from the front of sv, as far as the next markup or the safe end of the input so far.
+    ///  Returns false when there is nothing more to do until the next feed
+    bool text(const view_type sv, const bool at_end) {
+        auto t_out = grammar::Markup_::skip(sv);
+        std::size_t len = t_out ? sv.length() : static_cast<std::size_t>(t_out);
+        const bool complete = !t_out || at_end;
+
+        if (!complete) {
+            //  hold back a reference without its ';' and up to two ']' that may start a ']]>'
+            const auto amp = sv.find_last_of(CharT('&'));
+            if (amp != npos && sv.find(CharT(';'), amp) == npos) len = amp;
+            for (int i = 0; i < 2 && len && sv[len - 1] == CharT(']'); ++i) --len;
+        }
+        if (len == 0) return complete && !t_out;
+
+        const view_type raw = sv.substr(0, len);
+        if (m_open.empty()) {
+            //  only white space between the top level markup
+            if (grammar::S(raw) != raw.length()) {
+                fail();
+                return false;
+            }
+        } else if (!characters(raw)) {
+            fail();
+            return false;
+        }
+        m_pos += len;
+        return complete;
+    }
+
+    ///  hand the raw text to the handler with its references decoded
+    bool characters(const view_type raw) {
+        std::size_t end = 0;
+        while (end < raw.length()) {
+            auto t_out = grammar::CharData(raw.substr(end));
+            if (t_out) {
+                //  no more references in raw
+                m_handler.characters(raw.substr(end));
+                return true;
+            }
+            if (t_out != 0) m_handler.characters(raw.substr(end, t_out));
+            end += t_out;
+
+            if (raw[end] != CharT('&')) return false;   //  ']]>'
+            text_writer out{m_handler};
+            t_out = grammar::Reference(&out, raw.substr(end));
+            if (t_out) return false;
+            end += t_out;
+        }
+        return true;
+    }
+
+    Handler &m_handler;
+    xml_tag_buffer<CharT> m_tag;
+
+    std::basic_string<CharT> m_buf;     //  the unconsumed tail of the input
+    std::size_t m_pos = 0;              //  parsed up to here in m_buf
+    std::size_t m_consumed = 0;         //  dropped from the front of m_buf so far
+
+    std::size_t m_scan = npos;          //  how far the end of the pending markup has been searched for
+    CharT m_quote = CharT();            //  the pending tag is inside a value quoted by m_quote
+
+    std::basic_string<CharT> m_names;   //  names of the open elements end to end, innermost last
+    std::vector<std::size_t> m_open;    //  where each open name starts in m_names
+
+    bool m_started = false;             //  a token has been parsed, the xml declaration must come first
+    bool m_error = false;
+};
+
+#endif //PARSER_XML_PUSH_H
@@ -0,0 +1,269 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_READER_H
+#define PARSER_XML_READER_H
+
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "jacob_parser.h"
+#include "xml_sax.h"
+
+///  what an xml_reader is positioned on
+enum class xml_token {
+    none,               //  next() has not been called yet
+    xml_declaration,    //  attributes()
+    start_element,      //  name() and attributes()
+    end_element,        //  name()
+    text,               //  value()
+    comment,            //  value()
+    pi,                 //  name() is the target, value() the data
+    cdata,              //  value()
+    end_document,
+    error
+};
+
+std::ostream &operator<<(std::ostream &lhs, xml_token rhs) {
+    switch (rhs) {
+        case xml_token::none:
+            return lhs << "None Token";
+        case xml_token::xml_declaration:
+            return lhs << "XML Declaration Token";
+        case xml_token::start_element:
+            return lhs << "Start Element Token";
+        case xml_token::end_element:
+            return lhs << "End Element Token";
+        case xml_token::text:
+            return lhs << "Text Token";
+        case xml_token::comment:
+            return lhs << "Comment Token";
+        case xml_token::pi:
+            return lhs << "Processing Instruction Token";
+        case xml_token::cdata:
+            return lhs << "CDATA Token";
+        case xml_token::end_document:
+            return lhs << "End Document Token";
+        case xml_token::error:
+            return lhs << "Error Token";
+    }
+    return lhs;
+}
+
+///  A cursor over a document.  Every next() parses one token with the xml_traits productions and stops, the open
+///  elements are kept on an explicit stack instead of the call stack, so a reader can stop at any point and only pays
+///  for what it has read.  The views it hands out point into the source, which must outlive the reader and, like
+///  every other parse, be followed by a '\0'.  A view is valid until the next call to next() or skip_subtree().
+template<typename CharT = char, typename Trace = xml_null_trace>
+class xml_reader {
+    using grammar = xml_traits<CharT, Trace>;
+    using view_type = std::basic_string_view<CharT>;
+    using attr_container = typename xml_tag_buffer<CharT>::attr_container;
+
+public:
+    explicit xml_reader(const view_type sv) : m_src(sv), m_pos(grammar::BOM(sv)) {}
+
+    ///  the reader keeps owner alive for as long as it views sv
+    xml_reader(const view_type sv, std::shared_ptr<const void> owner) : xml_reader(sv) { m_source = std::move(owner); }
+
+    ///  Read the file at path from a read only mapping of it, which the reader keeps alive.  A file that can not be
+    ///  mapped reads as an error token
+    static xml_reader open_file(const char *path, const xml_map_options &options = {}) {
+        auto file = std::make_shared<xml_mapped_file>();
+        if (file->open(path, options)) return xml_reader();
+        const auto sv = file->view<CharT>();
+        return xml_reader(sv, std::move(file));
+    }
+
+    ///  advance to the next token and return it.  end_document and error are final
+    xml_token next() {
+        if (m_token == xml_token::error || m_token == xml_token::end_document) return m_token;
+
+        //  an empty element tag is reported as a start and an end
+        if (m_empty) {
+            m_empty = false;
+            m_raw = view_type();
+            return m_token = xml_token::end_element;
+        }
+
+        if (m_open.empty()) {
+            //  prolog, and misc after the root, only markup and white space
+            m_pos += grammar::S(m_src.substr(m_pos));
+            if (m_pos == m_src.length()) return m_token = xml_token::end_document;
+            if (m_src[m_pos] != CharT('<')) return fail();
+            return markup();
+        }
+
+        if (m_src[m_pos] != CharT('<')) return text();
+        if (m_src[m_pos + 1] == CharT('/')) return end_tag();
+        return markup();
+    }
+
+    ///  Positioned on a start_element, move to its end_element.  The content in between is passed over by
+    ///  grammar::skip_content, which finds the markup boundaries without validating or decoding anything.
+    ///  Anywhere else it does nothing.  Returns false when the document is broken
+    bool skip_subtree() {
+        if (m_token != xml_token::start_element) return m_token != xml_token::error;
+        if (m_empty) {
+            next();
+            return true;
+        }
+
+        auto t_out = grammar::skip_content(m_src.substr(m_pos));
+        if (t_out) {
+            fail();
+            return false;
+        }
+        m_raw = m_src.substr(m_pos, t_out);
+        m_pos += t_out;
+        m_name = m_open.back();
+        m_open.pop_back();
+        m_token = xml_token::end_element;
+        return true;
+    }
+
+    [[nodiscard]] xml_token token() const noexcept { return m_token; }
+
+    ///  element name, or the target of a PI
+    [[nodiscard]] view_type name() const noexcept { return m_name; }
+
+    ///  text with its references decoded, or the contents of a comment, PI or CDATA section
+    [[nodiscard]] view_type value() const { return m_value.view(); }
+
+    ///  the source text of the current token
+    [[nodiscard]] view_type raw() const noexcept { return m_raw; }
+
+    ///  attributes of a start_element or xml_declaration, with their references decoded
+    [[nodiscard]] const attr_container &attributes() const noexcept { return m_tag.attributes(); }
+
+    ///  elements open around the current token, a start_element counts itself and an end_element does not
+    [[nodiscard]] std::size_t depth() const noexcept { return m_open.size() + (m_empty ? 1 : 0); }
+
+    ///  offset of the next token into the source, where it stopped on an error
+    [[nodiscard]] std::size_t offset() const noexcept { return m_pos; }
+
+private:
+    static constexpr std::size_t npos = grammar::npos;
+
+    ///  a reader with nothing to read
+    xml_reader() : m_pos(0), m_token(xml_token::error) {}
+
+    xml_token fail() noexcept { return m_token = xml_token::error; }
+
+    ///  the token sv parsed to, m_pos moved past it
+    xml_token take(const xml_token t, const std::size_t len) {
+        m_raw = m_src.substr(m_pos, len);
+        m_pos += len;
+        return m_token = t;
+    }
+
+    xml_token markup() {
+        const view_type sv = m_src.substr(m_pos);
+        m_name = view_type();
+        m_value.clear();
+
+        switch (identify_node_type<CharT>(sv)) {
+            case node_type::element: {
+                m_tag.clear();
+                auto out = grammar::Stag_Emptytag(&m_tag, sv);
+                if (out.second) return fail();
+                m_tag.decode();
+                m_name = m_tag.name();
+                if (out.first) m_empty = true; else m_open.push_back(m_name);
+                return take(xml_token::start_element, out.second);
+            }
+
+            case node_type::comment: {
+                //  the first 3 characters validated by the node_type check
+                if (sv[3] != CharT('-')) return fail();
+                auto cnt = grammar::Char_Comment(sv.substr(4));
+                if (cnt) return fail();
+                m_value.assign_view(sv.substr(4, cnt), false);
+                return take(xml_token::comment, 4 + cnt + 3);
+            }
+
+            case node_type::pi: {
+                std::size_t pos = 2;
+                auto t_out = grammar::PITarget(sv.substr(pos));
+                if (t_out) return fail();
+                m_name = sv.substr(pos, t_out);
+                pos += t_out;
+                pos += grammar::S(sv.substr(pos));
+                t_out = grammar::Char_PI(sv.substr(pos));
+                if (t_out) return fail();
+                m_value.assign_view(sv.substr(pos, t_out), false);
+                return take(xml_token::pi, pos + t_out + 2);
+            }
+
+            case node_type::cdata: {
+                auto t_out = grammar::CDStart(sv);
+                if (t_out) return fail();
+                std::size_t pos = t_out;
+                t_out = grammar::Char_CDATA(sv.substr(pos));
+                if (t_out) return fail();
+                m_value.assign_view(sv.substr(pos, t_out), false);
+                pos += t_out;
+                t_out = grammar::CDEnd(sv.substr(pos));
+                if (t_out) return fail();
+                return take(xml_token::cdata, pos + t_out);
+            }
+
+            case node_type::xmldecl: {
+                //  only as the first token
+                if (m_token != xml_token::none) return fail();
+                m_tag.clear();
+                auto t_out = grammar::XMLDecl(&m_tag, sv);
+                if (t_out) return fail();
+                return take(xml_token::xml_declaration, t_out);
+            }
+
+            default:
+                return fail();
+        }
+    }
+
+    xml_token end_tag() {
+        auto t_out = grammar::Etag(m_open.back(), m_src.substr(m_pos));
+        if (t_out) return fail();
+        m_name = m_open.back();
+        m_open.pop_back();
+        m_value.clear();
+        return take(xml_token::end_element, t_out);
+    }
+
+    xml_token text() {
+        //  CharData with references up to the next markup, decoded when value() is first asked for
+        std::size_t end = m_pos;
+        bool coded = false;
+        for (;;) {
+            auto t_out = grammar::CharData(m_src.substr(end));
+            if (t_out) return fail();
+            end += t_out;
+            if (m_src[end] == CharT('<')) break;
+            if (m_src[end] != CharT('&')) return fail();
+            t_out = grammar::Reference(m_src.substr(end));
+            if (t_out) return fail();
+            end += t_out;
+            coded = true;
+        }
+        m_name = view_type();
+        m_value.assign_view(m_src.substr(m_pos, end - m_pos), coded);
+        return take(xml_token::text, end - m_pos);
+    }
+
+    view_type m_src;
+    std::size_t m_pos;
+    xml_token m_token = xml_token::none;
+
+    std::vector<view_type> m_open;  //  names of the open elements, innermost last
+    bool m_empty = false;           //  on the start of an empty element tag, its end comes next
+
+    view_type m_raw;
+    view_type m_name;
+    xml_string<CharT> m_value;
+    xml_tag_buffer<CharT> m_tag;
+    std::shared_ptr<const void> m_source;   //  keeps a mapped source alive
+};
+
+#endif //PARSER_XML_READER_H
@@ -0,0 +1,386 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_SAX_H
+#define PARSER_XML_SAX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "jacob_parser.h"
+
+///  an attribute as handed to a sax handler, the value has its references decoded
+template<typename CharT>
+struct xml_sax_attribute {
+    std::basic_string_view<CharT> name;
+    std::basic_string_view<CharT> value;
+};
+
+///  The name and attributes of one tag, filled in by xml_traits::Stag_Emptytag or xml_traits::XMLDecl.  It is cleared
+///  and reused from tag to tag, so its memory only grows with the largest tag.
+template<typename CharT>
+class xml_tag_buffer {
+public:
+    using view_type = std::basic_string_view<CharT>;
+    using attr_container = std::vector<xml_sax_attribute<CharT>>;
+
+    void clear() noexcept {
+        m_name = view_type();
+        m_attrs.clear();
+        m_table.clear();
+        m_coded_len = 0;
+    }
+
+    void assign_name(const view_type name) noexcept { m_name = name; }
+
+    ///  value is raw, coded when it holds references.  false when the tag already has an attribute called name
+    bool insert_attribute(const view_type name, const view_type value, const bool coded) {
+        auto names = [this](std::size_t i) { return m_attrs[i].name; };
+        if (m_table.find(name, m_attrs.size(), names) != m_table.npos) return false;
+        if (coded) m_coded_len += value.length();
+        m_attrs.push_back({name, value});
+        m_table.added(m_attrs.size(), names);
+        return true;
+    }
+
+    ///  decode the values that hold references, they stay valid until the next clear
+    void decode() {
+        if (!m_coded_len) return;
+
+        //  decoded text is never longer than its source, so with the space reserved up front the decoded values
+        //  never move while the views are taken
+        m_text.clear();
+        m_text.reserve(m_coded_len);
+        for (auto &a : m_attrs) {
+            if (a.value.find(CharT('&')) == view_type::npos) continue;
+            const auto first = m_text.length();
+            xml_traits<CharT>::Decode(&m_text, a.value);
+            a.value = view_type(m_text.data() + first, m_text.length() - first);
+        }
+        m_coded_len = 0;
+    }
+
+    [[nodiscard]] view_type name() const noexcept { return m_name; }
+
+    [[nodiscard]] const attr_container &attributes() const noexcept { return m_attrs; }
+
+    ///  the attribute called name, or nullptr
+    [[nodiscard]] const xml_sax_attribute<CharT> *find(const view_type name) const {
+        auto names = [this](std::size_t i) { return m_attrs[i].name; };
+        const auto i = m_table.find(name, m_attrs.size(), names);
+        return i == m_table.npos ? nullptr : &m_attrs[i];
+    }
+
+    bool m_attr_quot = true;  //  written by the grammar
+
+private:
+    view_type m_name;
+    attr_container m_attrs;
+    xml_attr_table<CharT> m_table;
+    std::basic_string<CharT> m_text;
+    std::size_t m_coded_len = 0;
+};
+
+///  Every sax event with an empty body.  A handler derives from it and hides the events it wants, the parser calls
+///  them through the handler's own type so nothing is virtual and the calls inline.
+///
+///  Every view, and the attributes, are only valid for the duration of the call.
+template<typename CharT>
+struct xml_sax_handler {
+    using view_type = std::basic_string_view<CharT>;
+    using attributes = std::vector<xml_sax_attribute<CharT>>;
+
+    void xml_declaration(const attributes &) {}
+
+    void start_element(view_type /*name*/, const attributes &) {}
+
+    void end_element(view_type /*name*/) {}
+
+    ///  decoded text, one run of text may arrive in several calls
+    void characters(view_type) {}
+
+    void comment(view_type) {}
+
+    void pi(view_type /*target*/, view_type /*data*/) {}
+
+    void cdata(view_type) {}
+};
+
+///  Parses with the xml_traits productions but builds no tree, every node is handed to Handler as it is found.
+///  Memory use does not grow with the document, only with the most attributes on one element and the depth of the
+///  nesting, which set_max_depth bounds.
+template<typename CharT, typename Handler, typename Trace = xml_null_trace>
+class xml_sax_parser {
+    using grammar = xml_traits<CharT, Trace>;
+    using xml_result = result<std::size_t, xml_error>;
+    using view_type = std::basic_string_view<CharT>;
+
+    static constexpr std::size_t npos = grammar::npos;
+
+public:
+    explicit xml_sax_parser(Handler &handler) : m_handler(handler) {}
+
+    ///  Elements nested deeper than depth fail the parse with xml_error::too_deep, as in xml_document
+    void set_max_depth(std::size_t depth) { m_max_depth = depth; }
+
+    [[nodiscard]] std::size_t max_depth() const { return m_max_depth; }
+
+    ///  same return as xml_document::parse, the length parsed or npos on error
+    std::size_t parse(const std::basic_string<CharT> &str) { return parse(view_type(str)); }
+
+    ///  parse the file at path straight from a read only mapping of it, npos when it can not be mapped
+    std::size_t parse_file(const char *path, const xml_map_options &options = {}) {
+        xml_mapped_file file;
+        if (file.open(path, options)) return npos;
+        return parse(file.view<CharT>());
+    }
+
+    std::size_t parse(const view_type sv) {
+        std::size_t pos = 0;
+
+        //  Parse BOM
+        pos += grammar::BOM(sv);
+
+        //  Parse ProLog
+        {
+            auto t_out = Prolog(sv.substr(pos));
+            if (t_out) return static_cast<std::size_t>(t_out);
+            pos += t_out;
+        }
+
+        //  Parse Children
+        {
+            auto t_out = Document(sv.substr(pos));
+            if (t_out) return static_cast<std::size_t>(t_out);
+            pos += t_out;
+        }
+        return pos;
+    }
+
+private:
+    ///  decoding output that hands the text straight to the handler
+    struct text_writer {
+        Handler &m_handler;
+
+        void append(const CharT *p, std::size_t n) { if (n) m_handler.characters(view_type(p, n)); }
+
+        void append(const view_type v) { append(v.data(), v.length()); }
+
+        text_writer &operator+=(const CharT c) {
+            append(&c, 1);
+            return *this;
+        }
+    };
+
+    //  12 Comment
+    xml_result
+    Comment(const view_type sv) {
+        //  the first 3 characters validated by the node_type check
+        if (sv[3] != CharT('-')) return {npos, xml_error::unexpected};
+        auto cnt = grammar::Char_Comment(sv.substr(4));
+        if (cnt) return {npos, xml_error::unexpected};
+        m_handler.comment(sv.substr(4, cnt));
+        return {4 + cnt + 3, std::error_condition()};
+    }
+
+    //  14 PI
+    xml_result
+    PI(const view_type sv) {
+        std::size_t pos = 2;
+        auto t_target = grammar::PITarget(sv.substr(pos));
+        if (t_target) return {npos, xml_error::unexpected};
+        const view_type target = sv.substr(pos, t_target);
+        pos += t_target;
+        pos += grammar::S(sv.substr(pos));
+        auto t_out = grammar::Char_PI(sv.substr(pos));
+        if (t_out) return {npos, xml_error::unexpected};
+        m_handler.pi(target, sv.substr(pos, t_out));
+        return {pos + t_out + 2, std::error_condition()};
+    }
+
+    //  18 CDSect
+    xml_result
+    CDSect(const view_type sv) {
+        std::size_t pos = 0;
+        auto t_out = grammar::CDStart(sv);
+        if (t_out) return {npos, xml_error::unexpected};
+        pos += t_out;
+
+        t_out = grammar::Char_CDATA(sv.substr(pos));
+        if (t_out) return {npos, xml_error::unexpected};
+        m_handler.cdata(sv.substr(pos, t_out));
+        pos += t_out;
+
+        t_out = grammar::CDEnd(sv.substr(pos));
+        if (t_out) return {npos, xml_error::unexpected};
+        return {pos + t_out, std::error_condition()};
+    }
+
+    //  46 XMLDecl
+    xml_result
+    XMLDecl(const view_type sv) {
+        m_tag.clear();
+        auto t_out = grammar::XMLDecl(&m_tag, sv);
+        if (t_out) return {npos, xml_error::unexpected};
+        m_handler.xml_declaration(m_tag.attributes());
+        return t_out;
+    }
+
+    //  20 content, 21 Element
+    //  Nested elements are followed on a stack of the open names instead of by recursion, so any depth up to
+    //  max_depth parses in the same native stack.  The names view sv, which outlives the parse
+    xml_result
+    Element(const view_type sv) {
+        m_open.clear();
+        auto t_out = start_tag(sv);
+        if (t_out) return {npos, t_out.m_err};
+        std::size_t end = t_out;
+
+        //  CharData? ((element | Reference | CDSect | PI | Comment) CharData?)* of the innermost open element
+        while (!m_open.empty()) {
+            t_out = grammar::CharData(sv.substr(end));
+            if (t_out) return {npos, xml_error::unexpected};
+            if (t_out != 0) m_handler.characters(sv.substr(end, t_out));
+            end += t_out;
+
+            switch (sv[end]) {
+                case CharT('&'): {
+                    text_writer out{m_handler};
+                    t_out = grammar::Reference(&out, sv.substr(end));
+                    break;
+                }
+
+                case CharT('<'): {
+                    if (sv[end + 1] == CharT('/')) {
+                        t_out = end_tag(sv.substr(end));
+                        break;
+                    }
+                    const auto nt = identify_node_type<CharT>(sv.substr(end));
+                    t_out = nt == node_type::element ? start_tag(sv.substr(end)) : parse_node(sv.substr(end), nt);
+                    break;
+                }
+
+                case CharT('\0'):
+                default:
+                    return {npos, xml_error::unexpected};
+            }
+            if (t_out) return {npos, t_out.m_err};
+            end += t_out;
+        }
+        return {end, std::error_condition()};
+    }
+
+    ///  the start tag at the front of sv, the element is opened unless the tag is empty
+    xml_result
+    start_tag(const view_type sv) {
+        m_tag.clear();
+        auto out = grammar::Stag_Emptytag(&m_tag, sv);
+        if (out.second) return {npos, xml_error::unexpected};
+        m_tag.decode();
+
+        const view_type name = m_tag.name();
+        if (!out.first && m_open.size() == m_max_depth) return {npos, xml_error::too_deep};
+        m_handler.start_element(name, m_tag.attributes());
+        if (out.first) m_handler.end_element(name);
+        else m_open.push_back(name);
+        return {out.second, std::error_condition()};
+    }
+
+    ///  the end tag at the front of sv, of the innermost open element
+    xml_result
+    end_tag(const view_type sv) {
+        const view_type name = m_open.back();
+        auto t_out = grammar::Etag(name, sv);
+        if (t_out) return {npos, xml_error::unexpected};
+        m_open.pop_back();
+        m_handler.end_element(name);
+        return t_out;
+    }
+
+    //  45 Misc
+    xml_result
+    Misc(const view_type sv) {
+        std::size_t pos = 0;
+        for (;;) {
+            pos += grammar::S(sv.substr(pos));
+            if (sv[pos] != CharT('<')) break;
+            auto nt = identify_node_type<CharT>(sv.substr(pos));
+            if (nt != node_type::comment && nt != node_type::pi) break;
+            auto t_out = parse_node(sv.substr(pos), nt);
+            if (t_out) return {npos, xml_error::unexpected};
+            pos += t_out;
+        }
+        return {pos, std::error_condition()};
+    }
+
+    //  47 ProLog
+    xml_result
+    Prolog(const view_type sv) {
+        std::size_t pos = grammar::S(sv);
+
+        // parse xml declaration if present
+        if (sv[pos] != CharT('<')) return {npos, xml_error::unexpected};
+        if (identify_node_type<CharT>(sv.substr(pos)) == node_type::xmldecl) {
+            auto t_out = XMLDecl(sv.substr(pos));
+            if (t_out) return {npos, xml_error::unexpected};
+            pos += t_out;
+        }
+
+        // parse misc if present, doctypedecl is not supported yet
+        for (int i = 0; i < 2; ++i) {
+            auto t_out = Misc(sv.substr(pos));
+            if (t_out) return {npos, xml_error::unexpected};
+            pos += t_out;
+        }
+        return {pos, std::error_condition()};
+    }
+
+    //  48 Document
+    xml_result
+    Document(const view_type sv) {
+        std::size_t pos = 0;
+        while (pos < sv.length()) {
+            pos += grammar::S(sv.substr(pos));
+            if (pos == sv.length()) break;
+            if (sv[pos] != CharT('<')) return {npos, xml_error::unexpected};
+            auto t_out = parse_node(sv.substr(pos));
+            if (t_out) return {npos, t_out.m_err};
+            pos += t_out;
+        }
+        return {sv.length(), std::error_condition()};
+    }
+
+    xml_result
+    parse_node(const view_type sv) { return parse_node(sv, identify_node_type<CharT>(sv)); }
+
+    xml_result
+    parse_node(const view_type sv, const node_type nt) {
+        switch (nt) {
+            case node_type::element:
+                return Element(sv);
+
+            case node_type::comment:
+                return Comment(sv);
+
+            case node_type::cdata:
+                return CDSect(sv);
+
+            case node_type::pi:
+                return PI(sv);
+
+            case node_type::xmldecl:
+                return XMLDecl(sv);
+            default:
+                break;
+        }
+        return {npos, xml_error::other_fatal};
+    }
+
+    Handler &m_handler;
+    xml_tag_buffer<CharT> m_tag;    //  reused by every start tag
+    std::vector<view_type> m_open;  //  names of the open elements, innermost last
+    std::size_t m_max_depth = grammar::default_max_depth;
+};
+
+#endif //PARSER_XML_SAX_H
@@ -0,0 +1,357 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_SCAN_H
+#define PARSER_XML_SCAN_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+
+//  Vectorized character class scanning.  Every hot production eventually asks "where is the first code unit in this
+//  view that is (or is not) a member of a small ascii set", which std::basic_string_view answers one code unit at a
+//  time.  The kernels below answer it 16, 32 or 64 code units at a time.  The widest kernel the cpu supports is picked
+//  once at run time, and the scalar kernel is always available as the fallback.
+//
+//  Define XML_PARSER_NO_SIMD to compile the scalar kernel only.
+
+#if !defined(XML_PARSER_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define XML_PARSER_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+enum class scan_level {
+    scalar,
+    sse42,
+    avx2,
+    avx512
+};
+
+std::ostream &operator<<(std::ostream &lhs, scan_level rhs) {
+    switch (rhs) {
+        case scan_level::scalar:
+            return lhs << "scalar";
+        case scan_level::sse42:
+            return lhs << "sse4.2";
+        case scan_level::avx2:
+            return lhs << "avx2";
+        case scan_level::avx512:
+            return lhs << "avx512";
+    }
+    return lhs;
+}
+
+///  The set of code units a scan stops on.
+///  Every xml_constant set is ascii, so a 256 entry bit map is enough.  Wider code units are clamped to 0xFF before
+///  they are classified, and 0xFF is never a member of a constant set, so a clamped unit behaves like any other non
+///  member.
+struct xml_scan_set {
+    std::array<std::uint8_t, 32> bits{};     //  one bit per byte value, set when the scan stops on it
+    std::array<std::uint8_t, 16> lo_rows{};  //  shuffle tables indexed by the low nibble, bit n is high nibble n
+    std::array<std::uint8_t, 16> hi_rows{};  //  same for high nibbles 8 - 15
+    std::array<std::uint8_t, 16> needles{};  //  the constant set itself when it fits in one pcmpestrm operand
+    int needle_count = 0;                    //  0 when the set does not fit
+    bool negative = false;                   //  stop on the code units NOT in needles
+
+    [[nodiscard]] constexpr bool test(std::uint8_t c) const noexcept {
+        return (bits[c >> 3u] >> (c & 7u)) & 1u;
+    }
+};
+
+template<typename CharT>
+constexpr xml_scan_set make_scan_set(const std::basic_string_view<CharT> s, const bool stop_on_member) noexcept {
+    using unsigned_type = std::make_unsigned_t<CharT>;
+    xml_scan_set out{};
+
+    for (unsigned c = 0; c < 256; ++c) {
+        bool member = false;
+        for (std::size_t i = 0; i < s.length(); ++i) {
+            if (static_cast<unsigned_type>(s[i]) == c) member = true;
+        }
+        if (member != stop_on_member) continue;
+
+        out.bits[c >> 3u] |= static_cast<std::uint8_t>(1u << (c & 7u));
+        if (c < 0x80) {
+            out.lo_rows[c & 0x0Fu] |= static_cast<std::uint8_t>(1u << (c >> 4u));
+        } else {
+            out.hi_rows[c & 0x0Fu] |= static_cast<std::uint8_t>(1u << ((c >> 4u) - 8));
+        }
+    }
+
+    if (s.length() <= out.needles.size()) {
+        for (std::size_t i = 0; i < s.length(); ++i) out.needles[i] = static_cast<std::uint8_t>(s[i]);
+        out.needle_count = static_cast<int>(s.length());
+        out.negative = !stop_on_member;
+    }
+    return out;
+}
+
+struct xml_scan_dispatch {
+    ///  the widest kernel this cpu and operating system support
+    static scan_level detect() noexcept {
+#ifdef XML_PARSER_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512bw")) return scan_level::avx512;
+        if (__builtin_cpu_supports("avx2")) return scan_level::avx2;
+        if (__builtin_cpu_supports("sse4.2")) return scan_level::sse42;
+#endif
+        return scan_level::scalar;
+    }
+
+    static bool supported(scan_level l) noexcept {
+        return static_cast<int>(l) <= static_cast<int>(detected());
+    }
+
+    static scan_level level() noexcept {
+        return current().load(std::memory_order_relaxed);
+    }
+
+    ///  force a narrower kernel, mostly useful for benchmarks.  Requests wider than the cpu supports are clamped.
+    static void set_level(scan_level l) noexcept {
+        current().store(supported(l) ? l : detected(), std::memory_order_relaxed);
+    }
+
+private:
+    static scan_level detected() noexcept {
+        static const scan_level l = detect();
+        return l;
+    }
+
+    static std::atomic<scan_level> &current() noexcept {
+        static std::atomic<scan_level> l{detected()};
+        return l;
+    }
+};
+
+namespace xml_scan_detail {
+
+    template<typename CharT>
+    constexpr std::uint8_t clamp(const CharT c) noexcept {
+        using unsigned_type = std::make_unsigned_t<CharT>;
+        const auto u = static_cast<unsigned_type>(c);
+        return u > 0xFFu ? std::uint8_t(0xFF) : static_cast<std::uint8_t>(u);
+    }
+
+    template<typename CharT>
+    std::size_t scalar(const CharT *p, std::size_t i, const std::size_t n, const xml_scan_set &set) noexcept {
+        for (; i < n; ++i) {
+            if (set.test(clamp(p[i]))) return i;
+        }
+        return n;
+    }
+
+#ifdef XML_PARSER_SIMD_X86
+
+    //  ************ sse4.2 ********************
+
+    __attribute__((target("sse4.2")))
+    inline unsigned mask_sse42(const __m128i bytes, const xml_scan_set &set) noexcept {
+        if (set.needle_count) {
+            const __m128i needles = _mm_loadu_si128(reinterpret_cast<const __m128i *>(set.needles.data()));
+            const auto m = static_cast<unsigned>(_mm_cvtsi128_si32(
+                    _mm_cmpestrm(needles, set.needle_count, bytes, 16,
+                                 _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK)));
+            return set.negative ? (~m & 0xFFFFu) : m;
+        }
+        //  Mula's universal byte set lookup:  the low nibble selects a row, the high nibble selects a bit in the row
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        const __m128i lo = _mm_and_si128(bytes, nibble);
+        const __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble);
+        const __m128i row = _mm_blendv_epi8(
+                _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(set.lo_rows.data())), lo),
+                _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(set.hi_rows.data())), lo),
+                _mm_cmpgt_epi8(hi, _mm_set1_epi8(7)));
+        const __m128i bit = _mm_shuffle_epi8(
+                _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128), hi);
+        return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), bit)));
+    }
+
+    //  narrow the next 16 code units to bytes, clamping anything above 0xFF
+    template<typename CharT>
+    __attribute__((target("sse4.2")))
+    inline __m128i load16_sse42(const CharT *p) noexcept {
+        if constexpr (sizeof(CharT) == 1) {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        } else if constexpr (sizeof(CharT) == 2) {
+            const __m128i top = _mm_set1_epi16(0xFF);
+            const __m128i a = _mm_min_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), top);
+            const __m128i b = _mm_min_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 8)), top);
+            return _mm_packus_epi16(a, b);
+        } else {
+            const __m128i top = _mm_set1_epi32(0xFF);
+            const __m128i a = _mm_min_epu32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), top);
+            const __m128i b = _mm_min_epu32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 4)), top);
+            const __m128i c = _mm_min_epu32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 8)), top);
+            const __m128i d = _mm_min_epu32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 12)), top);
+            return _mm_packus_epi16(_mm_packus_epi32(a, b), _mm_packus_epi32(c, d));
+        }
+    }
+
+    template<typename CharT>
+    __attribute__((target("sse4.2")))
+    std::size_t sse42(const CharT *p, const std::size_t n, const xml_scan_set &set) noexcept {
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            const unsigned m = mask_sse42(load16_sse42(p + i), set);
+            if (m) return i + static_cast<std::size_t>(__builtin_ctz(m));
+        }
+        return scalar(p, i, n, set);
+    }
+
+    //  ************ avx2 ********************
+
+    __attribute__((target("avx2")))
+    inline unsigned mask_avx2(const __m256i bytes, const xml_scan_set &set) noexcept {
+        const __m256i nibble = _mm256_set1_epi8(0x0F);
+        const __m256i lo = _mm256_and_si256(bytes, nibble);
+        const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble);
+        const __m256i lo_rows = _mm256_broadcastsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(set.lo_rows.data())));
+        const __m256i hi_rows = _mm256_broadcastsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(set.hi_rows.data())));
+        const __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(lo_rows, lo),
+                                               _mm256_shuffle_epi8(hi_rows, lo),
+                                               _mm256_cmpgt_epi8(hi, _mm256_set1_epi8(7)));
+        const __m256i bit = _mm256_shuffle_epi8(
+                _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                 1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128), hi);
+        return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit)));
+    }
+
+    //  narrow the next 32 code units to bytes.  The pack instructions work per 128 bit lane so the result is
+    //  permuted back into source order.
+    template<typename CharT>
+    __attribute__((target("avx2")))
+    inline __m256i load32_avx2(const CharT *p) noexcept {
+        if constexpr (sizeof(CharT) == 1) {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        } else if constexpr (sizeof(CharT) == 2) {
+            const __m256i top = _mm256_set1_epi16(0xFF);
+            const __m256i a = _mm256_min_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)), top);
+            const __m256i b = _mm256_min_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 16)), top);
+            return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        } else {
+            const __m256i top = _mm256_set1_epi32(0xFF);
+            const __m256i a = _mm256_min_epu32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)), top);
+            const __m256i b = _mm256_min_epu32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 8)), top);
+            const __m256i c = _mm256_min_epu32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 16)), top);
+            const __m256i d = _mm256_min_epu32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 24)), top);
+            const __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(a, b), _mm256_packus_epi32(c, d));
+            return _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+        }
+    }
+
+    template<typename CharT>
+    __attribute__((target("avx2")))
+    std::size_t avx2(const CharT *p, const std::size_t n, const xml_scan_set &set) noexcept {
+        std::size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            const unsigned m = mask_avx2(load32_avx2(p + i), set);
+            if (m) return i + static_cast<std::size_t>(__builtin_ctz(m));
+        }
+        return scalar(p, i, n, set);
+    }
+
+    //  ************ avx512 ********************
+
+    //  gcc 12 reports the deliberately undefined operands inside its own avx512 intrinsics as maybe uninitialized
+#if !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+    __attribute__((target("avx512f,avx512bw")))
+    inline std::uint64_t mask_avx512(const __m512i bytes, const xml_scan_set &set) noexcept {
+        const __m512i nibble = _mm512_set1_epi8(0x0F);
+        const __m512i lo = _mm512_and_si512(bytes, nibble);
+        const __m512i hi = _mm512_and_si512(_mm512_srli_epi16(bytes, 4), nibble);
+        const __m512i lo_rows = _mm512_broadcast_i32x4(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(set.lo_rows.data())));
+        const __m512i hi_rows = _mm512_broadcast_i32x4(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(set.hi_rows.data())));
+        const __m512i row = _mm512_mask_blend_epi8(_mm512_cmpgt_epi8_mask(hi, _mm512_set1_epi8(7)),
+                                                   _mm512_shuffle_epi8(lo_rows, lo),
+                                                   _mm512_shuffle_epi8(hi_rows, lo));
+        const __m512i bit = _mm512_shuffle_epi8(_mm512_broadcast_i32x4(
+                _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128)), hi);
+        return _mm512_test_epi8_mask(row, bit);
+    }
+
+    //  narrow the next 64 code units to bytes with the saturating down converts
+    template<typename CharT>
+    __attribute__((target("avx512f,avx512bw")))
+    inline __m512i load64_avx512(const CharT *p) noexcept {
+        if constexpr (sizeof(CharT) == 1) {
+            return _mm512_loadu_si512(p);
+        } else if constexpr (sizeof(CharT) == 2) {
+            const __m256i a = _mm512_cvtusepi16_epi8(_mm512_loadu_si512(p));
+            const __m256i b = _mm512_cvtusepi16_epi8(_mm512_loadu_si512(p + 32));
+            return _mm512_inserti64x4(_mm512_inserti64x4(_mm512_setzero_si512(), a, 0), b, 1);
+        } else {
+            __m512i out = _mm512_inserti32x4(_mm512_setzero_si512(), _mm512_cvtusepi32_epi8(_mm512_loadu_si512(p)), 0);
+            out = _mm512_inserti32x4(out, _mm512_cvtusepi32_epi8(_mm512_loadu_si512(p + 16)), 1);
+            out = _mm512_inserti32x4(out, _mm512_cvtusepi32_epi8(_mm512_loadu_si512(p + 32)), 2);
+            return _mm512_inserti32x4(out, _mm512_cvtusepi32_epi8(_mm512_loadu_si512(p + 48)), 3);
+        }
+    }
+
+    template<typename CharT>
+    __attribute__((target("avx512f,avx512bw")))
+    std::size_t avx512(const CharT *p, const std::size_t n, const xml_scan_set &set) noexcept {
+        std::size_t i = 0;
+        for (; i + 64 <= n; i += 64) {
+            const std::uint64_t m = mask_avx512(load64_avx512(p + i), set);
+            if (m) return i + static_cast<std::size_t>(__builtin_ctzll(m));
+        }
+        return scalar(p, i, n, set);
+    }
+
+#if !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+}
+
+template<typename CharT>
+struct xml_scan {
+    using view_type = std::basic_string_view<CharT>;
+
+    ///  inputs shorter than this never leave the scalar kernel
+    static constexpr std::size_t simd_threshold = 16;
+
+    ///  index of the first code unit in [p, p + n) the set stops on, n when there is none
+    static std::size_t find(const CharT *p, const std::size_t n, const xml_scan_set &set) noexcept {
+        if (n < simd_threshold) return xml_scan_detail::scalar(p, 0, n, set);
+        return find(p, n, set, xml_scan_dispatch::level());
+    }
+
+    static std::size_t find(const CharT *p, const std::size_t n, const xml_scan_set &set, scan_level l) noexcept {
+        switch (l) {
+#ifdef XML_PARSER_SIMD_X86
+            case scan_level::avx512:
+                return xml_scan_detail::avx512(p, n, set);
+            case scan_level::avx2:
+                return xml_scan_detail::avx2(p, n, set);
+            case scan_level::sse42:
+                return xml_scan_detail::sse42(p, n, set);
+#endif
+            case scan_level::scalar:
+            default:
+                return xml_scan_detail::scalar(p, 0, n, set);
+        }
+    }
+
+    ///  view flavour of find, npos when there is no match
+    static std::size_t find(const view_type sv, const xml_scan_set &set) noexcept {
+        const auto out = find(sv.data(), sv.length(), set);
+        return out == sv.length() ? view_type::npos : out;
+    }
+};
+
+#endif //PARSER_XML_SCAN_H
@@ -0,0 +1,172 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_STATS_H
+#define PARSER_XML_STATS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory_resource>
+#include <ostream>
+#include <vector>
+
+//  xml_stats depends on production, jacob_parser.h includes it after xml_trace.h
+
+///  A snapshot of the counters of an xml_stats_resource
+struct xml_memory_stats {
+    ///  size class i holds allocations of up to 8 << i bytes, the last one everything larger
+    static constexpr std::size_t size_classes = 18;
+
+    ///  one per production, and the last for allocations made outside any production or without xml_alloc_trace
+    static constexpr std::size_t productions = static_cast<std::size_t>(production::Document) + 2;
+
+    std::uint64_t allocations = 0;
+    std::uint64_t deallocations = 0;
+    std::uint64_t bytes_allocated = 0;
+    std::uint64_t bytes_deallocated = 0;
+    std::uint64_t bytes_in_use = 0;
+    std::uint64_t peak_bytes = 0;
+    std::array<std::uint64_t, size_classes> by_size{};
+    std::array<std::uint64_t, productions> bytes_by_production{};
+
+    ///  upper bound in bytes of size class i, 0 for the last
+    static constexpr std::size_t size_class_limit(std::size_t i) noexcept {
+        return i + 1 < size_classes ? std::size_t(8) << i : 0;
+    }
+};
+
+std::ostream &operator<<(std::ostream &lhs, const xml_memory_stats &rhs) {
+    lhs << "allocations : " << rhs.allocations
+        << " deallocations : " << rhs.deallocations
+        << " bytes allocated : " << rhs.bytes_allocated
+        << " bytes in use : " << rhs.bytes_in_use
+        << " peak bytes : " << rhs.peak_bytes << '\n';
+    for (std::size_t i = 0; i < rhs.by_size.size(); ++i) {
+        if (!rhs.by_size[i]) continue;
+        if (const auto limit = xml_memory_stats::size_class_limit(i)) lhs << "  <= " << limit;
+        else lhs << "  larger";
+        lhs << " : " << rhs.by_size[i] << '\n';
+    }
+    for (std::size_t i = 0; i < rhs.bytes_by_production.size(); ++i) {
+        if (!rhs.bytes_by_production[i]) continue;
+        if (i + 1 < rhs.bytes_by_production.size()) lhs << "  " << static_cast<production>(i);
+        else lhs << "  other";
+        lhs << " : " << rhs.bytes_by_production[i] << " bytes\n";
+    }
+    return lhs;
+}
+
+///  The production each thread is parsing, kept by xml_alloc_trace for xml_stats_resource to charge allocations to
+class xml_alloc_context {
+public:
+    static constexpr std::uint8_t none = xml_memory_stats::productions - 1;
+
+    static void push(production p) { stack().push_back(static_cast<std::uint8_t>(p)); }
+
+    static void pop() noexcept { stack().pop_back(); }
+
+    static std::uint8_t current() noexcept {
+        const auto &s = stack();
+        return s.empty() ? none : s.back();
+    }
+
+private:
+    static std::vector<std::uint8_t> &stack() noexcept {
+        thread_local std::vector<std::uint8_t> s;
+        return s;
+    }
+};
+
+///  Trace policy that tells xml_stats_resource which production is allocating
+///      xml_document<char, 4096, xml_alloc_trace> doc;
+struct xml_alloc_trace {
+    static void enter(production p) { xml_alloc_context::push(p); }
+
+    static void leave(production, std::size_t) noexcept { xml_alloc_context::pop(); }
+
+    static constexpr void node(node_type) noexcept {}
+};
+
+///  A memory_resource that counts what passes through it to upstream.  Every counter is a relaxed atomic, so it costs
+///  a few uncontended increments an allocation and can stay on in production.  Allocations are charged to the
+///  production xml_alloc_trace says the allocating thread is in, or to other.
+class xml_stats_resource : public std::pmr::memory_resource {
+public:
+    explicit xml_stats_resource(std::pmr::memory_resource *upstream = std::pmr::new_delete_resource()) noexcept :
+            m_upstream(upstream) {}
+
+    xml_stats_resource(const xml_stats_resource &) = delete;
+
+    xml_stats_resource &operator=(const xml_stats_resource &) = delete;
+
+    [[nodiscard]] std::pmr::memory_resource *upstream() const noexcept { return m_upstream; }
+
+    [[nodiscard]] xml_memory_stats stats() const noexcept {
+        xml_memory_stats out;
+        out.allocations = m_allocations.load(std::memory_order_relaxed);
+        out.deallocations = m_deallocations.load(std::memory_order_relaxed);
+        out.bytes_allocated = m_bytes_allocated.load(std::memory_order_relaxed);
+        out.bytes_deallocated = m_bytes_deallocated.load(std::memory_order_relaxed);
+        out.bytes_in_use = m_in_use.load(std::memory_order_relaxed);
+        out.peak_bytes = m_peak.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < out.by_size.size(); ++i)
+            out.by_size[i] = m_by_size[i].load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < out.bytes_by_production.size(); ++i)
+            out.bytes_by_production[i] = m_by_production[i].load(std::memory_order_relaxed);
+        return out;
+    }
+
+    ///  start counting again from zero
+    void reset_stats() noexcept {
+        for (auto c : {&m_allocations, &m_deallocations, &m_bytes_allocated, &m_bytes_deallocated, &m_in_use, &m_peak})
+            c->store(0, std::memory_order_relaxed);
+        for (auto &c : m_by_size) c.store(0, std::memory_order_relaxed);
+        for (auto &c : m_by_production) c.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static std::size_t size_class(std::size_t bytes) noexcept {
+        if (bytes <= 8) return 0;
+        const auto bits = static_cast<std::size_t>(64 - __builtin_clzll(static_cast<unsigned long long>(bytes - 1)));
+        return std::min(bits - 3, xml_memory_stats::size_classes - 1);
+    }
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+        auto p = m_upstream->allocate(bytes, alignment);
+        m_allocations.fetch_add(1, std::memory_order_relaxed);
+        m_bytes_allocated.fetch_add(bytes, std::memory_order_relaxed);
+        m_by_size[size_class(bytes)].fetch_add(1, std::memory_order_relaxed);
+        m_by_production[xml_alloc_context::current()].fetch_add(bytes, std::memory_order_relaxed);
+
+        const auto in_use = m_in_use.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        auto peak = m_peak.load(std::memory_order_relaxed);
+        while (in_use > peak && !m_peak.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {}
+        return p;
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+        m_deallocations.fetch_add(1, std::memory_order_relaxed);
+        m_bytes_deallocated.fetch_add(bytes, std::memory_order_relaxed);
+        m_in_use.fetch_sub(bytes, std::memory_order_relaxed);
+        m_upstream->deallocate(p, bytes, alignment);
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource *m_upstream;
+    std::atomic<std::uint64_t> m_allocations{0};
+    std::atomic<std::uint64_t> m_deallocations{0};
+    std::atomic<std::uint64_t> m_bytes_allocated{0};
+    std::atomic<std::uint64_t> m_bytes_deallocated{0};
+    std::atomic<std::uint64_t> m_in_use{0};
+    std::atomic<std::uint64_t> m_peak{0};
+    std::array<std::atomic<std::uint64_t>, xml_memory_stats::size_classes> m_by_size{};
+    std::array<std::atomic<std::uint64_t>, xml_memory_stats::productions> m_by_production{};
+};
+
+#endif //PARSER_XML_STATS_H
@@ -0,0 +1,156 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_STRING_H
+#define PARSER_XML_STRING_H
+
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+//  xml_string depends on xml_traits for decoding, jacob_parser.h includes it after xml_traits.h
+
+///  Decoding output that writes back over the raw text being decoded.  Decoded text is never longer than its source,
+///  so the write position never passes the read position.
+template<typename CharT>
+struct xml_insitu_writer {
+    using view_type = std::basic_string_view<CharT>;
+
+    CharT *m_out;
+
+    void append(const CharT *p, std::size_t n) noexcept {
+        std::char_traits<CharT>::move(m_out, p, n);
+        m_out += n;
+    }
+
+    void append(const view_type v) noexcept { append(v.data(), v.length()); }
+
+    xml_insitu_writer &operator+=(const CharT c) noexcept {
+        *m_out++ = c;
+        return *this;
+    }
+};
+
+///  A name or value held by an xml_node.
+///  In parse_mode::copy it owns its (already decoded) text.  In parse_mode::view it is a view into the parsed source,
+///  and a view whose raw text still holds references is flagged and decoded into the owned string on first access.
+///  The first access of a flagged value writes to the string, so it is not safe to race on.
+template<typename CharT>
+class xml_string {
+    using grammar = xml_traits<CharT>;
+public:
+    using string_type = std::pmr::basic_string<CharT>;
+    using view_type = std::basic_string_view<CharT>;
+    using allocator_type = std::pmr::polymorphic_allocator<CharT>;
+
+    xml_string() = default;
+
+    explicit xml_string(const allocator_type &alloc) : m_str(alloc) {}
+
+    xml_string(const xml_string &other, const allocator_type &alloc) : m_str(other.m_str, alloc),
+                                                                       m_view(other.m_view),
+                                                                       m_state(other.m_state) {}
+
+    xml_string(xml_string &&other, const allocator_type &alloc) : m_str(std::move(other.m_str), alloc),
+                                                                  m_view(other.m_view),
+                                                                  m_state(other.m_state) {}
+
+    xml_string(const xml_string &) = default;
+
+    xml_string(xml_string &&) noexcept = default;
+
+    xml_string &operator=(const xml_string &) = default;
+
+    xml_string &operator=(xml_string &&) noexcept = default;
+
+    ///  copy v, it is already decoded
+    void assign(const view_type v) {
+        m_str.assign(v.data(), v.length());
+        m_view = view_type();
+        m_state = state::owned;
+    }
+
+    ///  decode raw into the owned string
+    void assign_decoded(const view_type raw) {
+        m_str.clear();
+        grammar::Decode(&m_str, raw);
+        m_view = view_type();
+        m_state = state::owned;
+    }
+
+    ///  decode raw over itself and keep a view of the result, raw must be writable
+    void decode_in_place(const view_type raw) noexcept {
+        auto first = const_cast<CharT *>(raw.data());
+        xml_insitu_writer<CharT> out{first};
+        grammar::Decode(&out, raw);
+        assign_view(view_type(first, static_cast<std::size_t>(out.m_out - first)), false);
+    }
+
+    ///  keep a view of raw, coded when raw still holds references
+    void assign_view(const view_type raw, const bool coded) noexcept {
+        m_str.clear();
+        m_view = raw;
+        m_state = coded ? state::coded : state::view;
+    }
+
+    void clear() noexcept {
+        m_str.clear();
+        m_view = view_type();
+        m_state = state::owned;
+    }
+
+    ///  clear and give the owned string's memory back, before the arena it came from is rewound
+    void release() noexcept {
+        string_type(m_str.get_allocator()).swap(m_str);
+        m_view = view_type();
+        m_state = state::owned;
+    }
+
+    ///  the decoded text
+    [[nodiscard]] view_type view() const {
+        if (m_state == state::coded) {
+            m_str.clear();
+            grammar::Decode(&m_str, m_view);
+            m_state = state::owned;
+        }
+        return m_state == state::owned ? view_type(m_str) : m_view;
+    }
+
+    ///  true until a coded view has been decoded
+    [[nodiscard]] bool needs_decoding() const noexcept { return m_state == state::coded; }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return m_state == state::owned ? m_str.empty() : m_view.empty();
+    }
+
+    operator view_type() const { return view(); }
+
+    friend bool operator<(const xml_string &lhs, const xml_string &rhs) { return lhs.view() < rhs.view(); }
+
+    friend bool operator<(const xml_string &lhs, const view_type rhs) { return lhs.view() < rhs; }
+
+    friend bool operator<(const view_type lhs, const xml_string &rhs) { return lhs < rhs.view(); }
+
+    friend bool operator==(const xml_string &lhs, const view_type rhs) { return lhs.view() == rhs; }
+
+    friend bool operator!=(const xml_string &lhs, const view_type rhs) { return lhs.view() != rhs; }
+
+    friend std::basic_ostream<CharT> &operator<<(std::basic_ostream<CharT> &lhs, const xml_string &rhs) {
+        return lhs << rhs.view();
+    }
+
+private:
+    enum class state : std::uint8_t {
+        owned,  //  text lives in m_str
+        view,   //  text is m_view
+        coded   //  text is m_view once decoded
+    };
+
+    mutable string_type m_str;
+    view_type m_view;
+    mutable state m_state = state::owned;
+};
+
+#endif //PARSER_XML_STRING_H
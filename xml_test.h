@@ -0,0 +1,166 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_TEST_H
+#define PARSER_XML_TEST_H
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "jacob_parser.h"
+#include "xml_sax.h"
+
+//  What the *_test programs share: a count of the checks that failed, a comparison of the trees two parses built, a
+//  log of the sax events of a parse, and the documents to run them over.
+
+///  Checks that report what failed to std::cerr, report() is the exit code of the test
+class xml_test {
+public:
+    explicit xml_test(std::string name) : m_name(std::move(name)) {}
+
+    bool check(const bool ok, const std::string &what) {
+        ++m_checked;
+        if (!ok) {
+            ++m_failed;
+            std::cerr << m_name << " : " << what << '\n';
+        }
+        return ok;
+    }
+
+    int report() const {
+        std::cout << m_name << " : " << m_checked - m_failed << " of " << m_checked << " checks passed" << std::endl;
+        return m_failed != 0;
+    }
+
+private:
+    std::string m_name;
+    int m_checked = 0;
+    int m_failed = 0;
+};
+
+///  Where the trees under a and b first differ in type, name, value, attributes or children, empty when they do not.
+///  Walked on a stack, so trees of any depth compare
+template<typename CharT>
+std::string xml_tree_diff(const xml_node<CharT> &a, const xml_node<CharT> &b) {
+    std::vector<std::pair<const xml_node<CharT> *, const xml_node<CharT> *>> todo{{&a, &b}};
+    while (!todo.empty()) {
+        const auto [l, r] = todo.back();
+        todo.pop_back();
+        const std::string at = "at <" + std::string(l->name()) + "> ";
+        if (l->type() != r->type()) return at + "the types differ";
+        if (l->name() != r->name()) return at + "the names differ, " + std::string(r->name());
+        if (l->value() != r->value()) {
+            return at + "the values differ, \"" + std::string(l->value()) + "\" and \"" + std::string(r->value()) + '"';
+        }
+
+        const auto &la = l->attributes();
+        const auto &ra = r->attributes();
+        if (la.size() != ra.size()) return at + "the attribute counts differ";
+        for (std::size_t i = 0; i < la.size(); ++i) {
+            if (la[i].first.view() != ra[i].first.view() || la[i].second.view() != ra[i].second.view()) {
+                return at + "attribute " + std::string(la[i].first.view()) + " differs";
+            }
+        }
+
+        const auto &lc = l->children();
+        const auto &rc = r->children();
+        if (lc.size() != rc.size()) return at + "the child counts differ";
+        for (auto li = lc.begin(), ri = rc.begin(); li != lc.end(); ++li, ++ri) todo.emplace_back(&*li, &*ri);
+    }
+    return std::string();
+}
+
+///  A sax handler that writes every event down, one per line.  Text that arrives in pieces is joined, so two parsers
+///  that cut a run differently write the same events
+struct xml_test_events : xml_sax_handler<char> {
+    std::string log;
+    std::string text;
+
+    void flush() {
+        if (text.empty()) return;
+        log.append("text ").append(text).push_back('\n');
+        text.clear();
+    }
+
+    void add(const char *event, view_type a, view_type b = view_type()) {
+        flush();
+        log.append(event).push_back(' ');
+        log.append(a);
+        if (!b.empty()) log.append(" ").append(b);
+        log.push_back('\n');
+    }
+
+    void add_attributes(const attributes &attrs) {
+        for (auto &a : attrs) log.append("  ").append(a.name).append("=").append(a.value).push_back('\n');
+    }
+
+    void xml_declaration(const attributes &attrs) {
+        add("decl", view_type());
+        add_attributes(attrs);
+    }
+
+    void start_element(view_type name, const attributes &attrs) {
+        add("start", name);
+        add_attributes(attrs);
+    }
+
+    void end_element(view_type name) { add("end", name); }
+
+    void characters(view_type t) { text.append(t); }
+
+    void comment(view_type t) { add("comment", t); }
+
+    void pi(view_type target, view_type data) { add("pi", target, data); }
+
+    void cdata(view_type t) { add("cdata", t); }
+};
+
+///  documents that between them hold every kind of node, references in text and values, and text cut by markup
+inline std::vector<std::string> xml_test_corpus() {
+    std::vector<std::string> out{
+            "<a/>",
+            "<a>text</a>",
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?><!--before--><?pi data?>"
+            "<root a=\"1\" b='two &amp; three'><x>text &lt;here&gt;</x><y/><!--in--><![CDATA[raw <stuff> & ]]>"
+            "<?p q?><z k=\"&#65;&#x42;\">a&apos;b&quot;c</z>tail</root><!--after-->",
+            "<a>one&amp;two<b>three</b>four&#33;<c d=\"&lt;\"/>five</a>",
+            "<a  x = \"1\"  y='2' >  <b>  </b>\n\t<c/>  </a>",
+            "<a>&amp;</a>",
+            "<a>&gt;&lt;<b>&#65;&#66;</b>]</a>",
+            "<a>ends in white space</a><!--c-->\n \n",
+    };
+
+    //  a record feed, pretty printed
+    std::string feed = "<?xml version=\"1.0\"?>\n<feed>\n";
+    for (int i = 0; i < 200; ++i) {
+        const auto n = std::to_string(i);
+        feed += "  <item id=\"" + n + "\" type=\"" + (i % 3 ? "x" : "y") + "\">\n"
+                "    <title>Title " + n + " &amp; more</title>\n"
+                "    <tags><tag>a" + n + "</tag><tag>b" + n + "</tag></tags>\n"
+                "    <!-- item " + n + " --><![CDATA[<raw " + n + ">]]>\n"
+                "  </item>\n";
+    }
+    feed += "</feed>";
+    out.push_back(std::move(feed));
+
+    //  nested 300 deep, with text at every level
+    std::string deep;
+    for (int i = 0; i < 300; ++i) deep += "<d" + std::to_string(i % 7) + " n=\"" + std::to_string(i) + "\">t";
+    for (int i = 299; i >= 0; --i) deep += "u</d" + std::to_string(i % 7) + ">";
+    out.push_back(std::move(deep));
+    return out;
+}
+
+///  a document nested depth deep
+inline std::string xml_test_nested(const std::size_t depth) {
+    std::string out;
+    out.reserve(depth * 7 + 1);
+    for (std::size_t i = 0; i < depth; ++i) out += "<e>";
+    out += "x";
+    for (std::size_t i = 0; i < depth; ++i) out += "</e>";
+    return out;
+}
+
+#endif //PARSER_XML_TEST_H
@@ -0,0 +1,142 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_THREAD_POOL_H
+#define PARSER_XML_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///  A work stealing thread pool.  Every worker has its own queue and takes from the back of it, an idle worker steals
+///  from the front of the others, so a worker that runs out keeps busy as long as there is work anywhere.  Tasks
+///  submitted from a worker go on its own queue, tasks from outside are dealt round the queues.
+///
+///  parallel_for() is the way in for the parsers: the calling thread runs tasks too while it waits.
+class xml_thread_pool {
+public:
+    ///  threads defaults to one per hardware thread
+    explicit xml_thread_pool(std::size_t threads = 0) {
+        const auto n = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t i = 0; i < n; ++i) m_queues.push_back(std::make_unique<queue>());
+        for (std::size_t i = 0; i < n; ++i) m_threads.emplace_back([this, i] { work(i); });
+    }
+
+    xml_thread_pool(const xml_thread_pool &) = delete;
+
+    xml_thread_pool &operator=(const xml_thread_pool &) = delete;
+
+    ///  runs what is queued, then joins
+    ~xml_thread_pool() {
+        {
+            std::lock_guard lock(m_wake_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto &t : m_threads) t.join();
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return m_threads.size(); }
+
+    void submit(std::function<void()> task) {
+        const auto self = worker_index();
+        const auto q = self < m_queues.size() && current_pool() == this
+                       ? self : m_next.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+        {
+            std::lock_guard lock(m_queues[q]->mutex);
+            m_queues[q]->tasks.push_back(std::move(task));
+        }
+        m_pending.fetch_add(1, std::memory_order_release);
+        {
+            std::lock_guard lock(m_wake_mutex);
+        }
+        m_wake.notify_one();
+    }
+
+    ///  f(i) for every i below n, on the pool and the calling thread, returning once all of them have
+    template<typename F>
+    void parallel_for(std::size_t n, F &&f) {
+        if (n == 0) return;
+        std::atomic<std::size_t> left{n};
+        for (std::size_t i = 1; i < n; ++i) {
+            submit([&f, &left, i] {
+                f(i);
+                left.fetch_sub(1, std::memory_order_acq_rel);
+            });
+        }
+        f(0);
+        left.fetch_sub(1, std::memory_order_acq_rel);
+
+        //  help rather than sleep, the tasks left may be waiting on a queue
+        const auto start = current_pool() == this ? worker_index() : m_next.load(std::memory_order_relaxed);
+        while (left.load(std::memory_order_acquire) != 0) {
+            if (!run_one(start)) std::this_thread::yield();
+        }
+    }
+
+private:
+    struct queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    static std::size_t &worker_index() noexcept {
+        thread_local std::size_t index = static_cast<std::size_t>(-1);
+        return index;
+    }
+
+    static xml_thread_pool *&current_pool() noexcept {
+        thread_local xml_thread_pool *pool = nullptr;
+        return pool;
+    }
+
+    ///  run one task, the back of queue self first and then the front of the others.  false when there was none
+    bool run_one(std::size_t self) {
+        const auto n = m_queues.size();
+        std::function<void()> task;
+        for (std::size_t i = 0; i < n && !task; ++i) {
+            auto &q = *m_queues[(self + i) % n];
+            std::lock_guard lock(q.mutex);
+            if (q.tasks.empty()) continue;
+            if (i == 0) {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+            } else {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+        }
+        if (!task) return false;
+        m_pending.fetch_sub(1, std::memory_order_relaxed);
+        task();
+        return true;
+    }
+
+    void work(std::size_t self) {
+        worker_index() = self;
+        current_pool() = this;
+        for (;;) {
+            if (run_one(self)) continue;
+            std::unique_lock lock(m_wake_mutex);
+            m_wake.wait(lock, [this] { return m_stop || m_pending.load(std::memory_order_acquire) != 0; });
+            if (m_stop && m_pending.load(std::memory_order_acquire) == 0) return;
+        }
+    }
+
+    std::vector<std::unique_ptr<queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<std::size_t> m_next{0};
+    std::atomic<std::size_t> m_pending{0};
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+};
+
+#endif //PARSER_XML_THREAD_POOL_H
@@ -0,0 +1,237 @@
+//
+// Created by jacob on 10/17/26.
+//
+
+#ifndef PARSER_XML_TRACE_H
+#define PARSER_XML_TRACE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+
+//  xml_trace depends on node_type, jacob_parser.h includes it ahead of xml_traits.h
+
+///  the productions xml_traits reports to its Trace policy
+enum class production : std::uint8_t {
+    Name,
+    Reference,
+    AttValue,
+    Attribute,
+    Stag_Emptytag,
+    Etag,
+    Comment,
+    PI,
+    CDSect,
+    CharData,
+    content,
+    Element,
+    XMLDecl,
+    Misc,
+    Prolog,
+    Document
+};
+
+std::ostream &operator<<(std::ostream &lhs, production rhs) {
+    switch (rhs) {
+        case production::Name:
+            return lhs << "Name";
+        case production::Reference:
+            return lhs << "Reference";
+        case production::AttValue:
+            return lhs << "AttValue";
+        case production::Attribute:
+            return lhs << "Attribute";
+        case production::Stag_Emptytag:
+            return lhs << "Stag_Emptytag";
+        case production::Etag:
+            return lhs << "Etag";
+        case production::Comment:
+            return lhs << "Comment";
+        case production::PI:
+            return lhs << "PI";
+        case production::CDSect:
+            return lhs << "CDSect";
+        case production::CharData:
+            return lhs << "CharData";
+        case production::content:
+            return lhs << "content";
+        case production::Element:
+            return lhs << "Element";
+        case production::XMLDecl:
+            return lhs << "XMLDecl";
+        case production::Misc:
+            return lhs << "Misc";
+        case production::Prolog:
+            return lhs << "Prolog";
+        case production::Document:
+            return lhs << "Document";
+    }
+    return lhs;
+}
+
+/*
+ *  A Trace policy is a type with three static hooks, called by xml_traits while it parses
+ *
+ *      enter(production p)                     p is about to be parsed
+ *      leave(production p, std::size_t bytes)  p is done, bytes is the length it consumed or npos when it failed
+ *      node(node_type t)                       a node of type t was created
+ *
+ *  Every enter is matched by a leave, so nested productions leave in the reverse order they entered.
+ */
+
+///  the default Trace policy, it compiles to nothing
+struct xml_null_trace {
+    static constexpr void enter(production) noexcept {}
+
+    static constexpr void leave(production, std::size_t) noexcept {}
+
+    static constexpr void node(node_type) noexcept {}
+};
+
+enum class trace_event : std::uint8_t {
+    enter,
+    leave,
+    node
+};
+
+std::ostream &operator<<(std::ostream &lhs, trace_event rhs) {
+    switch (rhs) {
+        case trace_event::enter:
+            return lhs << "enter";
+        case trace_event::leave:
+            return lhs << "leave";
+        case trace_event::node:
+            return lhs << "node";
+    }
+    return lhs;
+}
+
+///  one event drained from an xml_trace_ring
+struct xml_trace_record {
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    std::uint64_t seq;      //  order the event was pushed in, across every thread
+    trace_event event;
+    production prod;        //  enter and leave
+    node_type type;         //  node
+    std::size_t bytes;      //  leave, npos when the production failed
+};
+
+std::ostream &operator<<(std::ostream &lhs, const xml_trace_record &rhs) {
+    lhs << rhs.seq << ' ' << rhs.event << ' ';
+    switch (rhs.event) {
+        case trace_event::enter:
+            return lhs << rhs.prod;
+        case trace_event::leave:
+            lhs << rhs.prod << ' ';
+            if (rhs.bytes == xml_trace_record::npos) return lhs << "failed";
+            return lhs << rhs.bytes;
+        case trace_event::node:
+            return lhs << rhs.type;
+    }
+    return lhs;
+}
+
+///  A fixed size ring of trace events.  Any number of threads may push, pushing never blocks and never fails, once the
+///  ring is full the oldest events are overwritten.  One thread at a time may drain it.
+template<std::size_t Capacity = 4096>
+class xml_trace_ring {
+    static_assert(Capacity && !(Capacity & (Capacity - 1)), "xml_trace_ring capacity must be a power of two");
+
+public:
+    void push(trace_event e, production p, node_type t, std::size_t bytes) noexcept {
+        const std::uint64_t seq = m_head.fetch_add(1, std::memory_order_relaxed);
+        slot &s = m_slots[seq & (Capacity - 1)];
+
+        //  a seqlock per slot, the stamp is 0 while the event is written and seq + 1 once it is complete
+        s.stamp.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.event.store(pack(e, p, t, bytes), std::memory_order_relaxed);
+        s.stamp.store(seq + 1, std::memory_order_release);
+    }
+
+    ///  calls f(const xml_trace_record &) on every event pushed since the last drain, oldest first.  Events
+    ///  overwritten before they could be drained, or still being written, are counted in dropped().
+    ///  Returns the number of events passed to f.
+    template<typename F>
+    std::size_t drain(F &&f) {
+        const std::uint64_t head = m_head.load(std::memory_order_acquire);
+        std::size_t count = 0;
+        if (head - m_tail > Capacity) {
+            m_dropped += head - Capacity - m_tail;
+            m_tail = head - Capacity;
+        }
+        for (; m_tail != head; ++m_tail) {
+            const slot &s = m_slots[m_tail & (Capacity - 1)];
+            const auto stamp = s.stamp.load(std::memory_order_acquire);
+            const auto packed = s.event.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (stamp != m_tail + 1 || s.stamp.load(std::memory_order_relaxed) != stamp) {
+                ++m_dropped;
+                continue;
+            }
+            const xml_trace_record record = unpack(m_tail, packed);
+            f(record);
+            ++count;
+        }
+        return count;
+    }
+
+    ///  events lost to overwriting since the ring was created
+    [[nodiscard]] std::uint64_t dropped() const noexcept { return m_dropped; }
+
+    ///  events pushed since the ring was created
+    [[nodiscard]] std::uint64_t pushed() const noexcept { return m_head.load(std::memory_order_relaxed); }
+
+private:
+    //  event, production and node type in the top 24 bits, bytes in the low 40
+    static constexpr std::uint64_t bytes_mask = (std::uint64_t(1) << 40u) - 1;
+
+    struct slot {
+        std::atomic<std::uint64_t> stamp{0};
+        std::atomic<std::uint64_t> event{0};
+    };
+
+    static std::uint64_t pack(trace_event e, production p, node_type t, std::size_t bytes) noexcept {
+        return (std::uint64_t(e) << 56u) | (std::uint64_t(p) << 48u) | (std::uint64_t(t) << 40u) |
+               (bytes < bytes_mask ? bytes : bytes_mask);
+    }
+
+    static xml_trace_record unpack(std::uint64_t seq, std::uint64_t packed) noexcept {
+        const auto bytes = packed & bytes_mask;
+        return {seq,
+                static_cast<trace_event>(packed >> 56u),
+                static_cast<production>((packed >> 48u) & 0xFFu),
+                static_cast<node_type>((packed >> 40u) & 0xFFu),
+                bytes == bytes_mask ? xml_trace_record::npos : static_cast<std::size_t>(bytes)};
+    }
+
+    std::array<slot, Capacity> m_slots{};
+    alignas(64) std::atomic<std::uint64_t> m_head{0};
+    alignas(64) std::uint64_t m_tail = 0;
+    std::uint64_t m_dropped = 0;
+};
+
+///  Trace policy that records every event into one xml_trace_ring shared by all documents using it
+///      xml_document<char, 4096, xml_ring_trace<>> doc;
+///      doc.parse(text);
+///      xml_ring_trace<>::ring().drain([](const xml_trace_record &r) { std::cout << r << '\n'; });
+template<std::size_t Capacity = 4096>
+struct xml_ring_trace {
+    static xml_trace_ring<Capacity> &ring() noexcept {
+        static xml_trace_ring<Capacity> r;
+        return r;
+    }
+
+    static void enter(production p) noexcept { ring().push(trace_event::enter, p, node_type::unknown, 0); }
+
+    static void leave(production p, std::size_t bytes) noexcept {
+        ring().push(trace_event::leave, p, node_type::unknown, bytes);
+    }
+
+    static void node(node_type t) noexcept { ring().push(trace_event::node, production::Document, t, 0); }
+};
+
+#endif //PARSER_XML_TRACE_H
@@ -7,26 +7,52 @@
 
 #include <string_view>
 #include <locale>
+#include <charconv>
+#include <array>
+#include <memory_resource>
+#include <vector>
 #include "xml_error_category.h"
 #include "result.h"
 #include "xml_constants.h"
+#include "xml_index.h"
 
 //  Note on style:  Somewhere I was watching a CppCon video, probably Kate Gregory, who indicated that out parameters
 //                  should be passed by pointer to differentiate them from other variables, and make it explicit that
 //                  we are changing data that the function doesn't own.  Or something like that, or someone like that.
 
-template<typename CharT>
+template<typename CharT, typename Trace = xml_null_trace>
 class xml_traits {
 private:
     using xml_result = result<std::size_t, xml_error>;
 
+    ///  reports a production to Trace, enter when it is constructed and leave when it goes out of scope.  The length is
+    ///  only known on success, consumed records it on the way out, every other exit is a failure
+    class trace_scope {
+    public:
+        explicit trace_scope(production p) noexcept : m_prod(p) { Trace::enter(p); }
+
+        trace_scope(const trace_scope &) = delete;
+
+        trace_scope &operator=(const trace_scope &) = delete;
+
+        ~trace_scope() { Trace::leave(m_prod, m_bytes); }
+
+        std::size_t consumed(std::size_t bytes) noexcept { return m_bytes = bytes; }
+
+    private:
+        const production m_prod;
+        std::size_t m_bytes = npos;
+    };
+
 public:
     using string_type = std::pmr::basic_string<CharT>;
     using view_type = std::basic_string_view<CharT>;
-    using pair_type = std::pair<string_type, string_type>;
 
     static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
 
+    ///  elements nested deeper than this fail with xml_error::too_deep, unless the caller gives a depth of its own
+    static constexpr std::size_t default_max_depth = std::size_t(1) << 20u;
+
 
     //  ************ parse functions ********************
 
@@ -39,25 +65,20 @@ public:
     //  1  Name
     static xml_result
     Name(const view_type sv) noexcept {
+        trace_scope trace(production::Name);
         if (!NameStartChar::contains(sv.front())) { return {npos, xml_error::unexpected}; }
         auto pos = NameChar::skip(sv);
-        return {pos, xml_error::no_error};
-    }
-
-    static xml_result
-    Name(string_type * st, const view_type sv) noexcept {
-        if (!NameStartChar::contains(sv.front())) { return {npos, xml_error::unexpected}; }
-        auto pos = NameChar::skip(sv);
-        st->assign(&sv[0], pos);
-        return {pos, xml_error::no_error};
+        return {trace.consumed(pos), xml_error::no_error};
     }
 
     //  2  S                C
     using S_ = xml_constant<CharT, false, constant::S>;
 
+    //  white space that runs to the end of sv is all of sv
     static inline xml_result
     S(const view_type sv) noexcept {
-        return {S_::skip(sv), std::error_condition()};
+        auto t_out = S_::skip(sv);
+        return {t_out ? sv.length() : static_cast<std::size_t>(t_out), std::error_condition()};
     }
 
     //  3  Eq
@@ -71,28 +92,29 @@ public:
     }
 
     //  4  CharRef
+    //  st may be null to only validate the reference
+    template<typename Out = string_type>
     static xml_error
-    CharRef(string_type * st, const view_type sv) noexcept {
+    CharRef(Out * st, const view_type sv) noexcept {
+        if (sv.empty()) return xml_error::other_fatal;
         if (sv.front() == CharT('x') || sv.front() == CharT('X')) {
             ///  Hexidecial
             unsigned long code = 0;
             auto result = std::from_chars(&sv[1], sv.end(), code, 16);
-            if (result.ptr == sv.end()) insert_coded_character(st, code); else {return xml_error::other_fatal;}
-            std::cout << code << std::endl;
+            if (result.ptr == sv.end()) { if (st) insert_coded_character(st, code); } else {return xml_error::other_fatal;}
         } else {
             ///  Decimal
             unsigned long code = 0;
             auto result = std::from_chars(&sv[0], sv.end(), code, 10);
-            if (result.ptr == sv.end()) insert_coded_character(st, code); else {return xml_error::other_fatal;}
-            std::cout << code << std::endl;
+            if (result.ptr == sv.end()) { if (st) insert_coded_character(st, code); } else {return xml_error::other_fatal;}
         }
         return xml_error::no_error;
     }
 
     //  5  EntityRef
+    template<typename Out = string_type>
     static void
-    EntityRef(string_type *st, const view_type sv) noexcept {
-        std::cout << "entity ref : " << sv << std::endl;
+    EntityRef(Out *st, const view_type sv) noexcept {
         switch (sv[1]) {
             // &amp; &apos;
             case CharT('a'):
@@ -134,10 +156,11 @@ public:
     }
 
 //  6  Reference
+    template<typename Out = string_type>
     static xml_result
-    Reference(string_type *st, const view_type sv) noexcept {
+    Reference(Out *st, const view_type sv) noexcept {
         std::size_t pos = sv.find(CharT(';'));
-        if (pos == sv.npos) {/*error*/}
+        if (pos == sv.npos) { return {npos, xml_error::unexpected}; }
         if (sv[1] == CharT('#')) {
             auto t_out = CharRef(st, sv.substr(2, pos - 2));
             if (t_out != xml_error::no_error) return {npos, t_out};
@@ -147,76 +170,124 @@ public:
         return {++pos, std::error_condition()};
     }
 
+    ///  length of the reference at the front of sv, validated but not decoded
+    static xml_result
+    Reference(const view_type sv) noexcept {
+        trace_scope trace(production::Reference);
+        std::size_t pos = sv.find(CharT(';'));
+        if (pos == sv.npos) { return {npos, xml_error::unexpected}; }
+        if (sv[1] == CharT('#')) {
+            auto t_out = CharRef<string_type>(nullptr, sv.substr(2, pos - 2));
+            if (t_out != xml_error::no_error) return {npos, t_out};
+        }
+        return {trace.consumed(++pos), std::error_condition()};
+    }
+
+    ///  append the raw text sv to st with every reference in it decoded.  Out is string_type or anything else with
+    ///  append(view_type), append(const CharT *, std::size_t) and += CharT, such as xml_insitu_writer
+    template<typename Out = string_type>
+    static xml_error
+    Decode(Out *st, const view_type sv) noexcept {
+        std::size_t start = 0;
+        for (auto end = sv.find(CharT('&')); end != npos; end = sv.find(CharT('&'), start)) {
+            st->append(sv.substr(start, end - start));
+            auto t_out = Reference(st, sv.substr(end));
+            if (t_out) return static_cast<xml_error>(t_out.m_err.value());
+            start = end + t_out;
+        }
+        st->append(sv.substr(start));
+        return xml_error::no_error;
+    }
+
     using AttValue_apos = xml_constant<CharT, true, constant::AttValue_apos>;
     using AttValue_quot = xml_constant<CharT, true, constant::AttValue_quot>;
 
 //  7  AttValue
+    //  the value is left raw, *coded is set when it holds references
     static xml_result
-    AttValue(string_type &st, const view_type sv) noexcept {
+    AttValue(bool *coded, const view_type sv) noexcept {
+        trace_scope trace(production::AttValue);
         if ((sv[0] != CharT('\"')) && (sv[0] != CharT('\''))) { return {npos, xml_error::unexpected}; }
         const CharT delim = sv.front();
-        std::size_t start = 1;
-        std::size_t end = start;
-        while (sv[end] != delim) {  // todo goal no raw loops
-            if (delim == CharT('\"')) {
-                end += AttValue_quot::skip(sv.substr(end));
-            } else {
-                end += AttValue_apos::skip(sv.substr(end));
-            }
+        std::size_t end = 1;
+        *coded = false;
+        for (;;) {  // todo goal no raw loops
+            auto t_out = (delim == CharT('\"')) ? AttValue_quot::skip(sv.substr(end))
+                                                : AttValue_apos::skip(sv.substr(end));
+            if (t_out) { return {npos, xml_error::unexpected}; }
+            end += t_out;
+
             switch (sv[end]) {
                 case CharT('\"'):
                 case CharT('\''):
-                    if (sv[end] == delim) st.append(&sv[start], end - start);
-                    break;
-
-                case CharT('&'):
-                    st.append(&sv[start], end - start);
-                    end += Reference(&st, sv.substr(end));
-                    start = end;
+                    //  only the delimiter is in the skip set
+                    ++end;
+                    return {trace.consumed(end), std::error_condition()};
+
+                case CharT('&'): {
+                    auto t_ref = Reference(sv.substr(end));
+                    if (t_ref) { return {npos, xml_error::unexpected}; }
+                    end += t_ref;
+                    *coded = true;
                     break;
+                }
 
                 case CharT('<'):
                 default:
                     return {npos, xml_error::unexpected};
             }
         }
-        ++end;
-        std::cout << "Attribute Value : " << st << std::endl;
-        return {end, std::error_condition()};
     }
 
 //  8  attribute
     static xml_result
-    Attribute(pair_type *pair, bool *quot, const view_type sv) noexcept {
+    Attribute(view_type *name, view_type *value, bool *coded, bool *quot, const view_type sv) noexcept {
+        trace_scope trace(production::Attribute);
         std::size_t pos = 0;
 
         //  skip whitespace
         pos += S(sv);
 
         //  Parse attrib name
-        pos += Name(&pair->first, sv.substr(pos));
-        std::cout << "attribute name : " << pair->first << std::endl;
+        {
+            auto t_out = Name(sv.substr(pos));
+            if (t_out) { return {npos, xml_error::unexpected}; }
+            *name = sv.substr(pos, t_out);
+            pos += t_out;
+        }
 
         //  Parse Eq
-        pos += Eq(sv.substr(pos));
+        {
+            auto t_out = Eq(sv.substr(pos));
+            if (t_out) { return {npos, xml_error::unexpected}; }
+            pos += t_out;
+        }
 
         // parse attrib value
         if (sv[pos] == CharT('\'')) {
             *quot = false;
-            pos += AttValue(pair->second, sv.substr(pos));
         } else if (sv[pos] == CharT('\"')) {
             *quot = true;
-            pos += AttValue(pair->second, sv.substr(pos));
         } else { return {npos, xml_error::unexpected}; }
+        {
+            auto t_out = AttValue(coded, sv.substr(pos));
+            if (t_out) { return {npos, xml_error::unexpected}; }
+            *value = sv.substr(pos + 1, t_out - 2);
+            pos += t_out;
+        }
 
-        return {pos, std::error_condition()};
+        return {trace.consumed(pos), std::error_condition()};
     }
 
 //  9  stag-emptytag
+    //  Node is an xml_node, or anything else with assign_name(name), insert_attribute(name, value, coded) returning
+    //  false on a repeated name, and an m_attr_quot flag
+    template<typename Node>
     static std::pair<bool, xml_result>
-    Stag_Emptytag(xml_node<CharT> *node, const view_type sv) noexcept {
+    Stag_Emptytag(Node *node, const view_type sv) noexcept {
         //  Stag:  '<' Name (S Attribute)* S? '>'
         //  Attribute:  Name eq attvalue
+        trace_scope trace(production::Stag_Emptytag);
         std::size_t pos = 0;
         bool empty_tag = false;
 
@@ -227,8 +298,10 @@ public:
         pos += S_::skip(sv.substr(pos));
 
         //  extract name
-        auto end = pos + Name(&node->m_name, sv.substr(pos));
-        std::cout << "stag name : " << node->name() << " Length : " << node->m_name.length() << std::endl;
+        auto t_name = Name(sv.substr(pos));
+        if (t_name) { return {true, {npos, xml_error::unexpected}}; }
+        node->assign_name(sv.substr(pos, t_name));
+        auto end = pos + t_name;
 
         xml_parser_attribute_parse:
         //  skip whitespace
@@ -244,20 +317,24 @@ public:
                 if (sv[++end] == CharT('>')) ++end;
                 break;
             default: {
-                pair_type attr = std::make_pair(string_type(node->get_alloc()), string_type(node->get_alloc()));
-                end += Attribute(&attr, &(node->m_attr_quot), sv.substr(end));
-                std::cout << std::boolalpha << "Attrib quot : " << node->m_attr_quot << std::endl;
-                node->insert_attribute(std::make_pair(std::move(attr.first), std::move(attr.second)));
+                view_type name, value;
+                bool coded = false;
+                auto t_out = Attribute(&name, &value, &coded, &(node->m_attr_quot), sv.substr(end));
+                if (t_out) { return {true, {npos, xml_error::unexpected}}; }
+                end += t_out;
+                //  attribute names are unique within a tag
+                if (!node->insert_attribute(name, value, coded)) { return {true, {npos, xml_error::unexpected}}; }
             }
                 goto xml_parser_attribute_parse;// todo find a better way to do this.  Either a recursive function or a loop
         }
-        return {empty_tag, {end, xml_error::no_error}};
+        return {empty_tag, {trace.consumed(end), xml_error::no_error}};
     }
 
 
 //  10 etag
     static inline xml_result
-    Etag(const string_type &st, const view_type sv) noexcept {
+    Etag(const view_type st, const view_type sv) noexcept {
+        trace_scope trace(production::Etag);
         std::size_t pos = 0;
 
         //  check for </
@@ -270,7 +347,6 @@ public:
 
         //  get name
         pos = s + Name(sv.substr(s));
-        std::cout << "end tag name : " << sv.substr(s, pos - s) << " : " << st << std::endl;
         if (sv.substr(s, pos - s) != st) { return {npos, xml_error::unexpected}; }
 
         //  skip whitespace
@@ -279,7 +355,7 @@ public:
         //  parse tag closure
         if (sv[pos] == CharT('>')) ++pos; else { return {npos, xml_error::unexpected}; }
 
-        return {pos, std::error_condition()};
+        return {trace.consumed(pos), std::error_condition()};
     }
 
 //  11 Char             C
@@ -287,23 +363,17 @@ public:
 
     static xml_result
     Char_Comment(const view_type sv) noexcept {
-        return Char_Comment_::skip(sv, [](const view_type c) {
-            if (c[0] == CharT('-')) {
-                if (c[1] == CharT('-')) {
-                    if (c[2] == CharT('>')) return action::return_; else return action::error_;
-                } else {
-                    return action::continue_;
-                }
-            }
-            return action::return_;
-        });
+        //  '--' may only appear as part of the closing '-->'
+        auto pos = Char_Comment_::find(sv, "--");
+        if (pos == npos || pos + 2 >= sv.length() || sv[pos + 2] != CharT('>')) return {npos, xml_error::unexpected};
+        return {pos, std::error_condition()};
     }
 
 //  12 Comment
     static xml_result
     Comment(xml_node<CharT> *node, const view_type sv) noexcept {
+        trace_scope trace(production::Comment);
         std::size_t pos = 0;
-        string_type output{node->get_alloc()};
 
         //  Verify comment start
         //  the first 3 characters validated by the node_type check
@@ -316,44 +386,41 @@ public:
         auto cnt = Char_Comment(sv.substr(pos));
         if (cnt) { return {npos, xml_error::unexpected}; }
         else {
-            handle_CharData(node, output.assign(&sv[pos], cnt));
+            handle_CharData(node, sv.substr(pos, cnt), false);
             pos += cnt;
             pos += 3;
         }
 
-        return {pos, std::error_condition()};
+        return {trace.consumed(pos), std::error_condition()};
     }
 
     using Char_PI_ = xml_constant<CharT, true, constant::CharPI>;
 
     static xml_result
     Char_PI(const view_type sv) noexcept {
-        return Char_PI_::skip(sv,
-                              [](const view_type c) {
-                                  if (c[0] == CharT('?')) {
-                                      if (c[1] == CharT('>')) return action::return_;
-                                      else return action::continue_;
-                                  }
-                                  return action::return_;
-                              });
+        auto pos = Char_PI_::find(sv, "?>");
+        if (pos == npos) return {npos, xml_error::unexpected};
+        return {pos, std::error_condition()};
     }
 
 //  13 PTTarget
     static inline xml_result
-    PITarget(string_type &st, const view_type sv) noexcept {
-        return Name(&st, std::forward<const view_type>(sv));
+    PITarget(const view_type sv) noexcept {
+        return Name(sv);
     }
 
 //  14 PI
     static xml_result
     PI(xml_node<CharT> *node, const view_type sv) noexcept {
         // '<?' PITarget (S (Char* - (Char* '?>' Char*)))? '?>'
+        trace_scope trace(production::PI);
         std::size_t pos = 2;
 
         //  get PI Target
         {
-            auto t_out = PITarget(node->m_name, &sv[pos]);
+            auto t_out = PITarget(sv.substr(pos));
             if (t_out) { return {npos, xml_error::unexpected}; }
+            node->assign_name(sv.substr(pos, t_out));
             pos += t_out;
         }
 
@@ -368,12 +435,11 @@ public:
         {
             auto t_out = Char_PI(sv.substr(pos));
             if (t_out) { return {npos, xml_error::unexpected}; }
-            node->m_value.assign(&sv[pos], t_out);
+            node->assign_value(sv.substr(pos, t_out), false);
             pos += t_out;
         }
-        std::cout << "PITarget : " << node->m_name << " -- Data : " << node->m_value << std::endl;
         pos += 2;
-        return {pos, std::error_condition()};
+        return {trace.consumed(pos), std::error_condition()};
     }
 
 //    struct Char_CDATA;
@@ -381,12 +447,9 @@ public:
 
     static xml_result
     Char_CDATA(const view_type sv) noexcept {
-        return Char_CDATA_::skip(sv, [](const view_type c) {
-            if (c[0] == CharT(']')) {
-                if (xml_const_compare(c, "]]>")) return action::return_; else return action::continue_;
-            }
-            return action::error_;
-        });
+        auto pos = Char_CDATA_::find(sv, "]]>");
+        if (pos == npos) return {npos, xml_error::unexpected};
+        return {pos, std::error_condition()};
     }
 
 //  15 CDEnd
@@ -406,8 +469,7 @@ public:
         auto pos = Char_CDATA(sv);
 
         if (pos) { return {npos, xml_error::unexpected}; }
-        node->m_value.assign(&sv.front(), pos);
-        std::cout << "CDATA : " << sv.substr(0, pos) << std::endl;
+        node->assign_value(sv.substr(0, pos), false);
         return {static_cast<std::size_t>(pos), std::error_condition()};
     }
 
@@ -423,6 +485,7 @@ public:
     static xml_result
     CDSect(xml_node<CharT> *node, const view_type sv) noexcept {
         //  CDSect	   ::=   	CDStart CData CDEnd
+        trace_scope trace(production::CDSect);
         std::size_t pos{0};
         //  skip start
         auto t_out = CDStart(sv);
@@ -438,8 +501,7 @@ public:
         t_out = CDEnd(sv.substr(pos));
         if (t_out) { return {npos, xml_error::unexpected}; }
         pos += t_out;
-        std::cout << "cdata len : " << pos << std::endl;
-        return {pos, std::error_condition()};
+        return {trace.consumed(pos), std::error_condition()};
     }
 
 //  19 CharData         C
@@ -448,87 +510,375 @@ public:
 
     static xml_result
     CharData(const view_type sv) noexcept {
-        return CharData_::skip(sv, [](const view_type c) {
+        trace_scope trace(production::CharData);
+        xml_result out = CharData_::skip(sv, [](const view_type c) {
             if (c[0] == CharT(']')) {
                 if (!xml_const_compare(c, "]]>")) return action::continue_; else return action::return_;
             }
             return action::return_;
         });
+        if (!out) trace.consumed(out);
+        return out;
     }
 
 //  20 content
+    //  the elements in it may nest max_depth deep
     static xml_result
-    content(xml_node<CharT> *node, const view_type sv) noexcept {
+    content(xml_node<CharT> *node, const view_type sv, const std::size_t max_depth = default_max_depth) noexcept {
         //  CharData? ((element | Reference | CDSect | PI | Comment) CharData?)*
-        std::size_t start = 0, end = 0;
-        string_type output{node->get_alloc()};
+        trace_scope trace(production::content);
+        auto out = content_items<false>(node, sv, max_depth);
+        if (!out) trace.consumed(out);
+        return out;
+    }
+
+    ///  The content from one cut to the next in a parallel parse, all of sv.  sv ends just after a child, so the
+    ///  content goes on past it and there is no end tag
+    static xml_result
+    content_part(xml_node<CharT> *node, const view_type sv, const std::size_t max_depth = default_max_depth) noexcept {
+        trace_scope trace(production::content);
+        auto out = content_items<true>(node, sv, max_depth);
+        if (!out) trace.consumed(out);
+        return out;
+    }
+
+//  21 Element
+    //  Nested elements are followed on an explicit stack of the open ones instead of by recursion, so any depth up to
+    //  max_depth parses in the same native stack.  Children are built in place at the end of their parent's list
+    static xml_result
+    Element(xml_node<CharT> *node, const view_type sv, const std::size_t max_depth = default_max_depth) noexcept {
+        scanned_text walk;
+        return Element(node, sv, max_depth, &walk);
+    }
+
+//  21 Element, deferred.  Only the name is parsed and the end of the element found, the rest is left in the node for
+//  xml_node::expand, with max_depth, what is left of the document's depth, to expand it with
+    static xml_result
+    Element_deferred(xml_node<CharT> *node, const view_type sv, const std::size_t max_depth) noexcept {
+        trace_scope trace(production::Element);
+        if (sv[0] != CharT('<')) { return {npos, xml_error::unexpected}; }
+        const auto pos = 1 + S_::skip(sv.substr(1));
+        auto t_name = Name(sv.substr(pos));
+        if (t_name) { return {npos, xml_error::unexpected}; }
+        node->assign_name(sv.substr(pos, t_name));
+
+        auto t_out = skip_tag(sv);
+        if (t_out) { return {npos, xml_error::unexpected}; }
+        std::size_t end = t_out;
+        if (sv[end - 2] != CharT('/')) {
+            if (max_depth == 0) { return {npos, xml_error::too_deep}; }
+            t_out = skip_content(sv.substr(end));
+            if (t_out) { return {npos, xml_error::unexpected}; }
+            end += t_out;
+        }
+        node->defer(sv.substr(0, end), max_depth);
+        return {trace.consumed(end), std::error_condition()};
+    }
+
+private:
+    ///  the text runs of Element are found by CharData
+    struct scanned_text {
+        static constexpr bool defers = false;
+
+        static constexpr std::size_t run_end(std::size_t) noexcept { return npos; }
+    };
+
+    ///  the child elements depth deep below the element are deferred
+    struct deferred_children : scanned_text {
+        static constexpr bool defers = true;
+
+        std::size_t depth = 1;
+    };
+
+    ///  Text runs looked up in a structural index of the view sv was taken from, at base in it.  A run is only taken
+    ///  from the index when the markup before it ended where the index has it end, and it holds no '&' or ']'
+    struct indexed_text {
+        static constexpr bool defers = false;
+
+        const xml_structural_index<CharT> &index;
+        std::size_t base = 0;
+        std::size_t markup = 0;     //  the next markup of the index that may end at or after the run
+
+        ///  where the run starting at sv[end] stops, npos when it has to be scanned
+        std::size_t run_end(const std::size_t end) noexcept {
+            const auto at = base + end;
+            while (markup < index.size() && index.end(markup) < at) ++markup;
+            if (markup == index.size() || index.end(markup) != at || !index.plain(markup)) return npos;
+            return index.start(markup + 1) - base;
+        }
+    };
 
-        while (!((sv[end] == CharT('<')) && (sv[end + 1] == CharT('/')))) {  // todo goal no raw loops
-            end += CharData(sv.substr(end));
-            if (end == sv.npos) { return {npos, xml_error::unexpected}; }
+    ///  Text runs are scanned for or looked up in an index, and children parsed or deferred, as Walk says
+    template<typename Walk>
+    static xml_result
+    Element(xml_node<CharT> *node, const view_type sv, const std::size_t max_depth, Walk *walk) noexcept {
+        struct open_element {
+            xml_node<CharT> *node;
+            std::size_t start;      //  of its start tag
+            std::size_t content;    //  of its content
+        };
+        //  the stack starts out in a buffer of its own and only takes from the node's arena past 32 deep
+        alignas(open_element) std::array<std::byte, 32 * sizeof(open_element)> local;
+        std::pmr::monotonic_buffer_resource stack_memory(local.data(), local.size(), node->get_alloc().resource());
+        std::pmr::vector<open_element> open(&stack_memory);
+        std::size_t start = 0, end = 0;     //  the text run, as in content
+        bool coded = false;
+
+        //  each open element is inside Element and content, a failure leaves them all
+        const auto fail = [&open](const xml_error e) -> xml_result {
+            for (std::size_t i = open.size(); i; --i) {
+                Trace::leave(production::content, npos);
+                Trace::leave(production::Element, npos);
+            }
+            return {npos, e};
+        };
+
+        //  the start tag of n at sv[at], n is opened unless the tag is empty
+        const auto open_tag = [&](xml_node<CharT> *n, const std::size_t at) -> xml_error {
+            Trace::enter(production::Element);
+            auto out = Stag_Emptytag(n, sv.substr(at));
+            if (out.second) {
+                Trace::leave(production::Element, npos);
+                return xml_error::unexpected;
+            }
+            end = at + out.second;
+            if (out.first) {
+                Trace::leave(production::Element, end - at);
+                return xml_error::no_error;
+            }
+            if (open.size() == max_depth) {
+                Trace::leave(production::Element, npos);
+                return xml_error::too_deep;
+            }
+            if (open.empty()) open.reserve(32);
+            open.push_back({n, at, end});
+            Trace::enter(production::content);
+            return xml_error::no_error;
+        };
+
+        if (auto e = open_tag(node, 0); e != xml_error::no_error) return {npos, e};
+        if (open.empty()) return {end, std::error_condition()};
+        start = end;
+
+        for (;;) {
+            auto *top = open.back().node;
+            if (const auto run = walk->run_end(end); run != npos) {
+                end = run;
+            } else if (sv[end] != CharT('<') || sv[end + 1] != CharT('/')) {
+                auto t_out = CharData(sv.substr(end));
+                if (t_out) return fail(xml_error::unexpected);
+                end += t_out;
+            }
 
             switch (sv[end]) {
-                case CharT('?'):
-                    if (end > start) output.append(&sv[start], end - start);
-                    {
-                        auto t_out = Reference(&output, sv.substr(end));
-                        if (t_out == npos) { return {npos, xml_error::unexpected}; }
-                        end += t_out;
-                    }
-                    start = end;
+                case CharT('&'): {
+                    auto t_out = Reference(sv.substr(end));
+                    if (t_out) return fail(xml_error::unexpected);
+                    end += t_out;
+                    coded = true;
                     break;
+                }
 
                 case CharT('<'): {
-                    if (sv[end + 1] == CharT('/')) break;
-                    if (end > start) output.append(&sv[start], end - start);
-                    if (!output.empty()) handle_CharData(node, output);
-                    {
-                        node_type nt = identify_node_type<CharT>(sv.substr(end));
-                        xml_node<CharT> ref = node->create_node(nt);
-                        auto t_out = parse_node(&ref, sv.substr(end));
-                        if (t_out) { return {npos, xml_error::unexpected}; }
-                        node->child_push_back(std::move(ref));
+                    if (end > start) handle_CharData(top, sv.substr(start, end - start), coded);
+                    coded = false;
+                    if (sv[end + 1] == CharT('/')) {
+                        //  close the innermost element
+                        const auto closing = open.back();
+                        open.pop_back();
+                        Trace::leave(production::content, end - closing.content);
+                        auto t_out = Etag(closing.node->name(), sv.substr(end));
+                        if (t_out) {
+                            Trace::leave(production::Element, npos);
+                            return fail(xml_error::unexpected);
+                        }
                         end += t_out;
+                        Trace::leave(production::Element, end - closing.start);
+                        if (open.empty()) return {end, std::error_condition()};
+                    } else {
+                        const node_type nt = identify_node_type<CharT>(sv.substr(end));
+                        auto &child = append_child(top, nt);
+                        bool deferred = false;
+                        if constexpr (Walk::defers) deferred = nt == node_type::element && open.size() >= walk->depth;
+                        if (nt == node_type::element && !deferred) {
+                            if (auto e = open_tag(&child, end); e != xml_error::no_error) return fail(e);
+                        } else if (deferred) {
+                            auto t_out = Element_deferred(&child, sv.substr(end), max_depth - open.size());
+                            if (t_out) return fail(xml_error::unexpected);
+                            end += t_out;
+                        } else {
+                            auto t_out = parse_node(&child, sv.substr(end));
+                            if (t_out) return fail(xml_error::unexpected);
+                            end += t_out;
+                        }
                     }
                     start = end;
                     break;
                 }
 
                 case CharT('\0'):
-                default: {
-                    return {npos, xml_error::unexpected};
-                }
+                default:
+                    return fail(xml_error::unexpected);
             }
         }
-        if (end > start) output.append(&sv[start], end - start);
-        if (!output.empty()) handle_CharData(node, output);
-        return {end, std::error_condition()};
     }
 
-//  21 Element
+public:
+//  Skipping.  For readers that have no use for what they pass over: only the boundaries of the markup are found,
+//  nothing between them is validated or decoded.
+    using Markup_ = xml_constant<CharT, true, constant::Markup>;
+    using TagClose_ = xml_constant<CharT, true, constant::TagClose>;
+
+    ///  length of the tag at the front of sv up to and including its '>', which may not be inside a quoted value
+    static xml_result
+    skip_tag(const view_type sv) noexcept {
+        std::size_t pos = 1;
+        for (;;) {
+            auto t_out = TagClose_::skip(sv.substr(pos));
+            if (t_out) return {npos, xml_error::unexpected};
+            pos += t_out;
+            if (sv[pos] == CharT('>')) return {pos + 1, std::error_condition()};
+
+            //  a quoted value, skip to the matching quote
+            auto end = sv.find(sv[pos], pos + 1);
+            if (end == npos) return {npos, xml_error::unexpected};
+            pos = end + 1;
+        }
+    }
+
+    ///  length of the comment, PI, CDATA section or tag at the front of sv
+    static xml_result
+    skip_markup(const view_type sv) noexcept {
+        std::size_t end;
+        if (sv[1] == CharT('?')) {
+            end = Char_PI_::find(sv.substr(2), "?>");
+            return end == npos ? xml_result{npos, xml_error::unexpected} : xml_result{end + 4, std::error_condition()};
+        }
+        if (xml_const_compare(sv, "<!--")) {
+            end = Char_Comment_::find(sv.substr(4), "-->");
+            return end == npos ? xml_result{npos, xml_error::unexpected} : xml_result{end + 7, std::error_condition()};
+        }
+        if (xml_const_compare(sv, "<![CDATA[")) {
+            end = Char_CDATA_::find(sv.substr(9), "]]>");
+            return end == npos ? xml_result{npos, xml_error::unexpected} : xml_result{end + 12, std::error_condition()};
+        }
+        return skip_tag(sv);
+    }
+
+    ///  length of the rest of an element, its content and its end tag, sv starts just after the start tag
+    static xml_result
+    skip_content(const view_type sv) noexcept {
+        std::size_t pos = 0, depth = 1;
+        for (;;) {
+            auto t_out = Markup_::skip(sv.substr(pos));
+            if (t_out) return {npos, xml_error::unexpected};
+            pos += t_out;
+
+            const auto markup = sv.substr(pos);
+            t_out = skip_markup(markup);
+            if (t_out) return {npos, xml_error::unexpected};
+            pos += t_out;
+
+            if (markup[1] == CharT('/')) {
+                if (--depth == 0) return {pos, std::error_condition()};
+            } else if (markup[1] != CharT('?') && markup[1] != CharT('!') && markup[t_out - 2] != CharT('/')) {
+                ++depth;
+            }
+        }
+    }
+
+//  Parallel parsing.  An element's content is cut after whole children into parts of about part_size, the parts are
+//  parsed at once on a pool, each into nodes from an arena of its own, and their children moved into the element in
+//  order.  Text is never cut, so the nodes are the ones the sequential parse makes.  Pool is anything with
+//  parallel_for(n, f), see xml_thread_pool.h
+
+    ///  Where the content at the front of sv may be cut: after a child, and part_size or more past the cut before.
+    ///  The cuts go in *cuts, 0 first, and the result is the length of the content up to its end tag.  Quotes, comments,
+    ///  CDATA sections and PIs are stepped over whole, nothing else is validated, that is left to the parts
     static xml_result
-    Element(xml_node<CharT> *node, const view_type sv) noexcept {
+    split_content(std::vector<std::size_t> *cuts, const view_type sv, const std::size_t part_size) {
+        cuts->assign(1, 0);
         std::size_t pos = 0;
+        for (;;) {
+            auto t_out = Markup_::skip(sv.substr(pos));
+            if (t_out) return {npos, xml_error::unexpected};
+            pos += t_out;
+            if (sv[pos + 1] == CharT('/')) return {pos, std::error_condition()};
+
+            const auto markup = sv.substr(pos);
+            t_out = skip_markup(markup);
+            if (t_out) return {npos, xml_error::unexpected};
+            pos += t_out;
+            if (markup[1] != CharT('?') && markup[1] != CharT('!') && markup[t_out - 2] != CharT('/')) {
+                t_out = skip_content(sv.substr(pos));
+                if (t_out) return {npos, xml_error::unexpected};
+                pos += t_out;
+            }
+            if (pos - cuts->back() >= part_size) cuts->push_back(pos);
+        }
+    }
+
+//  21 Element, its content parsed in parts on pool
+    template<typename Pool>
+    static xml_result
+    Element(xml_node<CharT> *node, const view_type sv, Pool *pool, xml_arena_set *arenas,
+            const std::size_t part_size, const std::size_t max_depth = default_max_depth) {
+        trace_scope trace(production::Element);
+        std::size_t pos = 0;
+        if (max_depth == 0) { return {npos, xml_error::too_deep}; }
 
-        //  parse start tag
         auto out = Stag_Emptytag(node, sv);
         if (out.second) { return {npos, xml_error::unexpected}; }
         pos += out.second;
-        std::cout << "start tag: " << sv.substr(0, pos) << " : " << sv[pos] << out.first << std::endl;
+        if (out.first) return {trace.consumed(pos), xml_error::no_error};
 
-        if (!out.first) {  //  If the Tag is not an EmptyTag then parse contents and Etag
-            //  parse content
-            auto cnt = content(node, sv.substr(pos));
-            if (cnt) { return {npos, xml_error::unexpected}; }
-            pos += cnt;
+        const auto body = sv.substr(pos);
+        std::vector<std::size_t> cuts;
+        auto length = split_content(&cuts, body, part_size);
+        if (length) { return {npos, xml_error::unexpected}; }
 
-            //  parse end tag
-            cnt = Etag(node->m_name, sv.substr(pos));
-            if (cnt) { return {npos, xml_error::unexpected}; }
-            pos += cnt;
+        if (cuts.size() == 1) {
+            auto cnt = content(node, body, max_depth - 1);
+            if (cnt) { return {npos, cnt.m_err}; }
+        } else {
+            cuts.push_back(length);
+
+            //  every part gets a node of its own in an arena of its own, the last runs to the end tag
+            std::vector<xml_node<CharT>> parts;
+            parts.reserve(cuts.size() - 1);
+            for (std::size_t i = 0; i + 1 < cuts.size(); ++i) {
+                parts.emplace_back(node_type::element, arenas->make(), node->m_mode);
+                parts.back().m_atoms = node->m_atoms;
+            }
+            std::vector<xml_result> results(parts.size());
+
+            //  the parts intern names at once, so the table locks while they run
+            const bool locked = node->m_atoms && !node->m_atoms->shared();
+            if (locked) node->m_atoms->set_shared(true);
+            pool->parallel_for(parts.size(), [&](std::size_t i) {
+                results[i] = i + 1 < parts.size()
+                             ? content_part(&parts[i], body.substr(cuts[i], cuts[i + 1] - cuts[i]), max_depth - 1)
+                             : content(&parts[i], body.substr(cuts[i]), max_depth - 1);
+            });
+            if (locked) node->m_atoms->set_shared(false);
+
+            for (std::size_t i = 0; i < parts.size(); ++i) {
+                if (results[i]) { return {npos, results[i].m_err}; }
+                if (results[i] != cuts[i + 1] - cuts[i]) { return {npos, xml_error::unexpected}; }
+            }
+
+            //  as handle_CharData would have, the element's value is its first text
+            for (auto &part : parts) {
+                if (node->m_value.empty() && !part.m_value.empty()) node->m_value = part.m_value;
+                for (auto &child : part.m_children) node->child_push_back(std::move(child));
+            }
         }
+        pos += length;
 
-        return {pos, xml_error::no_error};
+        auto cnt = Etag(node->name(), sv.substr(pos));
+        if (cnt) { return {npos, xml_error::unexpected}; }
+        pos += cnt;
+        return {trace.consumed(pos), xml_error::no_error};
     }
 
 //  22 cp
@@ -556,71 +906,80 @@ public:
 //  43 doctypedecl
 
 //  SDDecl
+    template<typename Node>
     static xml_result
-    SDDecl(xml_node<CharT> *node, const view_type sv) noexcept {
+    SDDecl(Node *node, const view_type sv) noexcept {
         // parse attribute
-        pair_type attr = std::make_pair(string_type(node->get_alloc()), string_type(node->get_alloc()));
-        std::size_t pos = Attribute(&attr, &(node->m_attr_quot), sv);
+        view_type name, value;
+        bool coded = false;
+        auto pos = Attribute(&name, &value, &coded, &(node->m_attr_quot), sv);
+        if (pos) return {npos, xml_error::unexpected};
         // verify name
-        if (!xml_const_compare(view_type(attr.first), "standalone")) return {npos, xml_error::unexpected};
+        if (!xml_const_compare(name, "standalone")) return {npos, xml_error::unexpected};
 
         // verify value
-        if ((!xml_const_compare(view_type(attr.second), "yes")) &&
-            (!xml_const_compare(view_type(attr.second), "no")))
+        if ((!xml_const_compare(value, "yes")) &&
+            (!xml_const_compare(value, "no")))
             return {npos, xml_error::unexpected};
 
-        node->insert_attribute(std::make_pair(std::move(attr.first), std::move(attr.second)));
+        node->insert_attribute(name, value, coded);
         return {pos, std::error_condition()};
     }
 
     static bool
     EncName(const view_type sv) noexcept {
-        auto i = sv.begin();
-        if (!xml_constant<CharT, false, constant::EncNameStart>::contains(*i)) return false;
-        ++i;
-        auto pos = xml_constant<CharT, false, constant::EncName>::skip(view_type(&*i));
+        if (sv.empty()) return false;
+        if (!xml_constant<CharT, false, constant::EncNameStart>::contains(sv.front())) return false;
+        auto pos = xml_constant<CharT, false, constant::EncName>::skip(sv.substr(1));
         if (pos != npos)
             return false; // this is hinky but if its npos then all the characters until the end are EncName
         return true;
     }
 
 //  EncodingDecl
+    template<typename Node>
     static xml_result
-    EncodingDecl(xml_node<CharT> *node, const view_type sv) noexcept {
+    EncodingDecl(Node *node, const view_type sv) noexcept {
         // parse attribute
-        pair_type attr = std::make_pair(string_type(node->get_alloc()), string_type(node->get_alloc()));
-        std::size_t pos = Attribute(&attr, &(node->m_attr_quot), sv);
+        view_type name, value;
+        bool coded = false;
+        auto pos = Attribute(&name, &value, &coded, &(node->m_attr_quot), sv);
+        if (pos) return {npos, xml_error::unexpected};
         // verify name
-        if (!xml_const_compare(view_type(attr.first), "encoding")) return {npos, xml_error::unexpected};
+        if (!xml_const_compare(name, "encoding")) return {npos, xml_error::unexpected};
 
         // verify value
-        if (!EncName(attr.second)) return {npos, xml_error::unexpected};
+        if (!EncName(value)) return {npos, xml_error::unexpected};
 
-        node->insert_attribute(std::make_pair(std::move(attr.first), std::move(attr.second)));
+        node->insert_attribute(name, value, coded);
         return {pos, std::error_condition()};
     }
 
 //  44 VersionInfo
+    template<typename Node>
     static xml_result
-    VersionInfo(xml_node<CharT> *node, const view_type sv) noexcept {
+    VersionInfo(Node *node, const view_type sv) noexcept {
         // parse attribute
-        pair_type attr = std::make_pair(string_type(node->get_alloc()), string_type(node->get_alloc()));
-        std::size_t pos = Attribute(&attr, &(node->m_attr_quot), sv);
+        view_type name, value;
+        bool coded = false;
+        auto pos = Attribute(&name, &value, &coded, &(node->m_attr_quot), sv);
+        if (pos) return {npos, xml_error::unexpected};
         // verify name
-        if (!xml_const_compare(view_type(attr.first), "version")) return {npos, xml_error::unexpected};
+        if (!xml_const_compare(name, "version")) return {npos, xml_error::unexpected};
 
         // verify value
         {
-            auto t_out = xml_constant<CharT, false, constant::digit>::skip(view_type(attr.second));
+            auto t_out = xml_constant<CharT, false, constant::digit>::skip(value);
             if (t_out != npos) return {npos, xml_error::unexpected};
         }
-        node->insert_attribute(std::make_pair(std::move(attr.first), std::move(attr.second)));
+        node->insert_attribute(name, value, coded);
         return {pos, std::error_condition()};
     }
 
 //  45 Misc
     static xml_result
     Misc(xml_node<CharT> *node, const view_type sv) noexcept {
+        trace_scope trace(production::Misc);
         std::size_t pos = 0;
         for (;;) {  // todo can i replace this with an alogorithm?
             pos += S(sv.substr(pos));
@@ -628,21 +987,21 @@ public:
             auto nt = identify_node_type<CharT>(sv.substr(pos));
             if (nt != node_type::comment && nt != node_type::pi) break;
             {
-                xml_node<CharT> ref = node->create_node(nt);
-                auto t_out = parse_node(&ref, sv.substr(pos));
+                auto t_out = parse_node(&append_child(node, nt), sv.substr(pos));
                 if (t_out != npos) {
-                    node->child_push_back(std::move(ref));
                     pos += t_out;
-                    std::cout << std::endl;
                 } else return {npos, xml_error::unexpected};
             }
         }
-        return {pos, std::error_condition()};
+        return {trace.consumed(pos), std::error_condition()};
     }
 
 //  46 XMLDecl
+    //  Node is an xml_node, or anything else with insert_attribute(name, value, coded) and an m_attr_quot flag
+    template<typename Node>
     static xml_result
-    XMLDecl(xml_node<CharT> *node, const view_type sv) noexcept {
+    XMLDecl(Node *node, const view_type sv) noexcept {
+        trace_scope trace(production::XMLDecl);
         std::size_t pos = 5;
 
         // skip whitespace
@@ -679,12 +1038,13 @@ public:
         if (xml_const_compare(sv.substr(pos), "?>")) pos += 2;
         else
             return {npos, xml_error::unexpected};
-        return {pos, std::error_condition()};
+        return {trace.consumed(pos), std::error_condition()};
     }
 
 //  47 ProLog
     static xml_result
     Prolog(xml_node<CharT> *node, const view_type sv) noexcept {
+        trace_scope trace(production::Prolog);
         std::size_t pos = 0;
         // skip whitespace
         {
@@ -698,10 +1058,8 @@ public:
             if (sv[pos] != CharT('<')) return {npos, xml_error::unexpected};
             auto nt = identify_node_type<CharT>(sv.substr(pos));
             if (nt == node_type::xmldecl) {
-                xml_node<CharT> ref = node->create_node(nt);
-                auto t_out = XMLDecl(&ref, sv.substr(pos));
+                auto t_out = XMLDecl(&append_child(node, nt), sv.substr(pos));
                 if (!t_out) {
-                    node->child_push_back(std::move(ref));
                     pos += t_out;
                 } else { return {npos, xml_error::unexpected}; }
             }
@@ -724,48 +1082,126 @@ public:
             if (t_out) return {npos, xml_error::unexpected};
             pos += t_out;
         }
-        std::cout << "exiting prolog" << std::endl << std::endl;
-        return {pos, std::error_condition()};
+        return {trace.consumed(pos), std::error_condition()};
     }
 
 //  48 Document
     static xml_result
-    Document(xml_node<CharT> *node, const view_type sv) noexcept {
+    Document(xml_node<CharT> *node, const view_type sv, const std::size_t max_depth = default_max_depth) noexcept {
 //        auto i = sv.begin();
+        trace_scope trace(production::Document);
         std::size_t pos = 0;
         while (pos < sv.length()) {  // todo goal no raw loops
-            //  skip whitespace
+            //  skip whitespace, which may run to the end
             pos += S(sv.substr(pos));
+            if (pos == sv.length()) break;
 
             //  Parse and emplace_back node onto list
             if (sv[pos] == CharT('<')) {
                 // get type
                 node_type nt = identify_node_type<CharT>(sv.substr(pos));
-                xml_node<CharT> ref = node->create_node(nt);
-                std::cout << nt << std::endl;
-                xml_result t_out = parse_node(&ref, sv.substr(pos));
+                xml_result t_out = parse_node(&append_child(node, nt), sv.substr(pos), max_depth);
                 if (!t_out) {
-                    node->child_push_back(std::move(ref));
                     pos += static_cast<std::size_t>(t_out);
                 } else {
 
-                    return {npos, xml_error::unexpected}; }
-
-                std::cout <<std::endl << "main loop : " << sv.substr(pos) << std::endl;
+                    return {npos, t_out.m_err}; }
             } else { return {npos, xml_error::unexpected}; }
         }
-        std::cout << "total length : " << std::distance(sv.begin(), sv.end()) << std::endl;
-        return {static_cast<unsigned long int>(std::distance(sv.begin(), sv.end())), std::error_condition()};
+        return {trace.consumed(sv.length()), std::error_condition()};
+    }
+
+//  48 Document, its elements parsed in parts on pool
+    template<typename Pool>
+    static xml_result
+    Document(xml_node<CharT> *node, const view_type sv, Pool *pool, xml_arena_set *arenas,
+             const std::size_t part_size, const std::size_t max_depth = default_max_depth) {
+        trace_scope trace(production::Document);
+        std::size_t pos = 0;
+        while (pos < sv.length()) {
+            pos += S(sv.substr(pos));
+            if (pos == sv.length()) break;
+            if (sv[pos] != CharT('<')) { return {npos, xml_error::unexpected}; }
+
+            node_type nt = identify_node_type<CharT>(sv.substr(pos));
+            auto &ref = append_child(node, nt);
+            xml_result t_out = nt == node_type::element
+                               ? Element(&ref, sv.substr(pos), pool, arenas, part_size, max_depth)
+                               : parse_node(&ref, sv.substr(pos));
+            if (t_out) { return {npos, t_out.m_err}; }
+            pos += static_cast<std::size_t>(t_out);
+        }
+        return {trace.consumed(sv.length()), std::error_condition()};
+    }
+
+//  48 Document, the text runs of its elements looked up in index, built over sv
+    static xml_result
+    Document(xml_node<CharT> *node, const view_type sv, const xml_structural_index<CharT> &index,
+             const std::size_t max_depth = default_max_depth) noexcept {
+        trace_scope trace(production::Document);
+        indexed_text walk{index};
+        std::size_t pos = 0;
+        while (pos < sv.length()) {
+            pos += S(sv.substr(pos));
+            if (pos == sv.length()) break;
+            if (sv[pos] != CharT('<')) { return {npos, xml_error::unexpected}; }
+
+            node_type nt = identify_node_type<CharT>(sv.substr(pos));
+            auto &ref = append_child(node, nt);
+            walk.base = pos;
+            xml_result t_out = nt == node_type::element ? Element(&ref, sv.substr(pos), max_depth, &walk)
+                                                        : parse_node(&ref, sv.substr(pos));
+            if (t_out) { return {npos, t_out.m_err}; }
+            pos += static_cast<std::size_t>(t_out);
+        }
+        return {trace.consumed(sv.length()), std::error_condition()};
+    }
+
+//  48 Document, its elements depth deep deferred, 0 defers the root itself.  See xml_node::expand
+    static xml_result
+    Document_deferred(xml_node<CharT> *node, const view_type sv, const std::size_t depth,
+                      const std::size_t max_depth = default_max_depth) noexcept {
+        trace_scope trace(production::Document);
+        deferred_children walk;
+        walk.depth = depth;
+        std::size_t pos = 0;
+        while (pos < sv.length()) {
+            pos += S(sv.substr(pos));
+            if (pos == sv.length()) break;
+            if (sv[pos] != CharT('<')) { return {npos, xml_error::unexpected}; }
+
+            node_type nt = identify_node_type<CharT>(sv.substr(pos));
+            auto &ref = append_child(node, nt);
+            xml_result t_out = nt != node_type::element ? parse_node(&ref, sv.substr(pos))
+                                                        : depth == 0 ? Element_deferred(&ref, sv.substr(pos), max_depth)
+                                                                     : Element(&ref, sv.substr(pos), max_depth, &walk);
+            if (t_out) { return {npos, t_out.m_err}; }
+            pos += static_cast<std::size_t>(t_out);
+        }
+        return {trace.consumed(sv.length()), std::error_condition()};
     }
 
 //  49 BOM
     static xml_result
-    BOM(view_type sv) noexcept;
+    BOM(const view_type sv) noexcept {
+        if constexpr (sizeof(CharT) == 1) {
+            if (static_cast<unsigned char>(sv[0]) == 0xEF
+                && static_cast<unsigned char>(sv[1]) == 0xBB
+                && static_cast<unsigned char>(sv[2]) == 0xBF)
+                return {3, std::error_condition()};
+        } else if constexpr (std::is_same_v<CharT, char32_t>) {
+            if (sv[0] == 0x0000feff || sv[0] == 0xfffe0000) return {1, std::error_condition()};
+        } else {
+            if (sv[0] == 0xfeff || sv[0] == 0xfffe) return {1, std::error_condition()};
+        }
+        return {0, std::error_condition()};
+    }
 
 private:
 
+    template<typename Out>
     static void
-    insert_coded_character(string_type * st, unsigned long code) noexcept {
+    insert_coded_character(Out * st, unsigned long code) noexcept {
         std::array<CharT, 4> text;
         if (code < 0x80)    // 1 byte sequence
         {
@@ -803,23 +1239,80 @@ private:
 
     }
 
-    static void
-    handle_CharData(xml_node<CharT> *node, string_type &st) noexcept {
-        if (node->m_value.empty()) node->assign_value(st);
+    ///  every node the grammar creates goes through here so Trace sees it.  The node is made in place as the last
+    ///  child of parent
+    static xml_node<CharT> &
+    append_child(xml_node<CharT> *parent, node_type nt) {
+        Trace::node(nt);
+        auto &out = parent->emplace_back_child(nt, parent->get_alloc(), parent->m_mode);
+        out.m_atoms = parent->m_atoms;
+        return out;
+    }
+
+    ///  the items of content up to its end tag, or when Part to the end of sv
+    template<bool Part>
+    static xml_result
+    content_items(xml_node<CharT> *node, const view_type sv, const std::size_t max_depth) noexcept {
+        //  a text run is kept raw from start to the next markup, coded records whether it holds references
+        std::size_t start = 0, end = 0;
+        bool coded = false;
+
+        while (Part ? end < sv.length() : !((sv[end] == CharT('<')) && (sv[end + 1] == CharT('/')))) {  // todo goal no raw loops
+            {
+                auto t_out = CharData(sv.substr(end));
+                if (t_out) { return {npos, xml_error::unexpected}; }
+                end += t_out;
+            }
+
+            switch (sv[end]) {
+                case CharT('&'): {
+                    auto t_out = Reference(sv.substr(end));
+                    if (t_out) { return {npos, xml_error::unexpected}; }
+                    end += t_out;
+                    coded = true;
+                    break;
+                }
+
+                case CharT('<'): {
+                    if (sv[end + 1] == CharT('/')) {
+                        if constexpr (Part) return {npos, xml_error::unexpected};  //  the cut was not after a child
+                        break;
+                    }
+                    if (end > start) handle_CharData(node, sv.substr(start, end - start), coded);
+                    coded = false;
+                    {
+                        node_type nt = identify_node_type<CharT>(sv.substr(end));
+                        auto t_out = parse_node(&append_child(node, nt), sv.substr(end), max_depth);
+                        if (t_out) { return {npos, t_out.m_err}; }
+                        end += t_out;
+                    }
+                    start = end;
+                    break;
+                }
 
-        xml_node<CharT> ref = node->create_node(node_type::data);
-        std::cout << "Element Value : " << st << std::endl;
-        ref.assign_value(std::move(st));
-        node->child_push_back(std::move(ref));
-        st.clear();
+                case CharT('\0'):
+                default: {
+                    return {npos, xml_error::unexpected};
+                }
+            }
+        }
+        if (end > start) handle_CharData(node, sv.substr(start, end - start), coded);
+        return {end, std::error_condition()};
+    }
+
+    static void
+    handle_CharData(xml_node<CharT> *node, const view_type raw, const bool coded) noexcept {
+        auto &ref = append_child(node, node_type::data);
+        //  raw is assigned once, parse_mode::in_situ decodes it over itself
+        ref.assign_value(raw, coded);
+        if (node->m_value.empty()) node->m_value = ref.m_value;
     }
 
     static xml_result
-    parse_node(xml_node<CharT> *node, const view_type sv) noexcept {
-        std::cout << "type : " << node->type() << std::endl;
+    parse_node(xml_node<CharT> *node, const view_type sv, const std::size_t max_depth = default_max_depth) noexcept {
         switch (node->type()) {
             case node_type::element:
-                return Element(node, sv);
+                return Element(node, sv, max_depth);
 
             case node_type::comment:
                 return Comment(node, sv);
@@ -839,31 +1332,4 @@ private:
     }
 };
 
-template<>
-result<std::size_t, xml_error> xml_traits<char>::BOM(const view_type sv) noexcept {
-    if (static_cast<unsigned char>(sv[0]) == 0xEF
-        && static_cast<unsigned char>(sv[1]) == 0xBB
-        && static_cast<unsigned char>(sv[2]) == 0xBF)
-        return {3, std::error_condition()};
-    return {0, std::error_condition()};
-}
-
-template<>
-result<std::size_t, xml_error> xml_traits<wchar_t>::BOM(const view_type sv) noexcept {
-    if (sv[0] == 0xfeff || sv[0] == 0xfffe) return {1, std::error_condition()};
-    return {0, std::error_condition()};
-}
-
-template<>
-result<std::size_t, xml_error> xml_traits<char16_t>::BOM(const view_type sv) noexcept {
-    if (sv[0] == 0xfeff || sv[0] == 0xfffe) return {1, std::error_condition()};
-    return {0, std::error_condition()};
-}
-
-template<>
-result<std::size_t, xml_error> xml_traits<char32_t>::BOM(const view_type sv) noexcept {
-    if (sv[0] == 0x0000feff || sv[0] == 0xfffe0000) return {1, std::error_condition()};
-    return {0, std::error_condition()};
-}
-
 #endif //PARSER_XML_TRAITS_H